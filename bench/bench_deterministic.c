@@ -0,0 +1,97 @@
+// bench_deterministic.c - cost of the bit-reproducible path: one pendulum
+// against compute() and compute_prepared(), then the threaded batch against
+// compute_batch() for a large ensemble.
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "arithmetic.h"
+#include "deterministic.h"
+
+#define STEPS 2000000
+#define BATCH 8192
+#define BATCH_STEPS 200
+#define DT 0.01
+
+static volatile double sink;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void fill(double *t1, double *t2, double *w1, double *w2) {
+    for (int i = 0; i < BATCH; i++) {
+        t1[i] = 0.5 + i * 1e-4;
+        t2[i] = -0.3 + i * 2e-4;
+        w1[i] = 0.0;
+        w2[i] = 0.1;
+    }
+}
+
+int main(void) {
+    double t1 = M_PI / 2.0, t2 = M_PI / 2.0, w1 = 0.0, w2 = 0.0;
+    double start = now_seconds();
+    for (int i = 0; i < STEPS; i++) {
+        compute(t1, t2, w1, w2, 1.0, 2.0, 1.5, 1.0, 9.81, DT, &t1, &t2, &w1, &w2);
+    }
+    double t_libm = now_seconds() - start;
+    sink = t2;
+
+    t1 = M_PI / 2.0, t2 = M_PI / 2.0, w1 = 0.0, w2 = 0.0;
+    start = now_seconds();
+    for (int i = 0; i < STEPS; i++) {
+        compute_deterministic(t1, t2, w1, w2, 1.0, 2.0, 1.5, 1.0, 9.81, DT, &t1, &t2, &w1, &w2);
+    }
+    double t_det = now_seconds() - start;
+    sink = t2;
+
+    // The fastest non-reproducible scalar path, for comparison.
+    PreparedConfig cfg;
+    prepare_config(&cfg, 1.0, 2.0, 1.5, 1.0, 9.81);
+    t1 = M_PI / 2.0, t2 = M_PI / 2.0, w1 = 0.0, w2 = 0.0;
+    start = now_seconds();
+    for (int i = 0; i < STEPS; i++) {
+        compute_prepared(&cfg, t1, t2, w1, w2, DT, &t1, &t2, &w1, &w2);
+    }
+    double t_prepared = now_seconds() - start;
+    sink = t2;
+
+    printf("scalar   compute %7.2f  prepared %7.2f  deterministic %7.2f Msteps/s\n",
+           STEPS / t_libm / 1e6, STEPS / t_prepared / 1e6, STEPS / t_det / 1e6);
+    printf("         deterministic cost: %.2fx compute, %.2fx prepared\n",
+           t_det / t_libm, t_det / t_prepared);
+
+    double *a = malloc(4 * BATCH * sizeof(double));
+    if (!a) return 1;
+    double *b = a + BATCH, *c = b + BATCH, *d = c + BATCH;
+    double total = (double)BATCH * BATCH_STEPS;
+
+    fill(a, b, c, d);
+    start = now_seconds();
+    for (int s = 0; s < BATCH_STEPS; s++) {
+        compute_batch(a, b, c, d, BATCH, 1.0, 2.0, 1.5, 1.0, 9.81, DT);
+    }
+    double t_batch = now_seconds() - start;
+    printf("batch    compute_batch            %7.2f Msteps/s\n", total / t_batch / 1e6);
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        fill(a, b, c, d);
+        start = now_seconds();
+        compute_batch_deterministic(a, b, c, d, BATCH, 1.0, 2.0, 1.5, 1.0, 9.81, DT,
+                                    BATCH_STEPS, threads);
+        double t = now_seconds() - start;
+        uint8_t hash[SHA256_BLOCK_SIZE];
+        deterministic_hash(a, b, c, d, BATCH, hash);
+        printf("batch    deterministic %d thread%s %7.2f Msteps/s  hash %02x%02x%02x%02x\n",
+               threads, threads == 1 ? " " : "s", total / t / 1e6,
+               hash[0], hash[1], hash[2], hash[3]);
+    }
+    printf("(%ld CPUs online; the hash must not change with the thread count)\n", cpus);
+    free(a);
+    return 0;
+}
@@ -0,0 +1,81 @@
+// bench_ensemble.c - memory per pendulum and stepping throughput of an
+// array of Pendulum structs against the arena-backed Ensemble.
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "ensemble.h"
+#include "pendulum.h"
+#include "arithmetic.h"
+
+#define COUNT 20000
+#define STEPS 200
+#define DT 0.01
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double initial_theta(size_t i) {
+    return M_PI / 2.0 + 1e-3 * (double)i / COUNT;
+}
+
+static double run_ensemble(int threads, size_t trails, size_t *bytes) {
+    EnsembleOptions opts;
+    ensemble_default_options(&opts);
+    opts.threads = threads;
+    opts.trail_length = trails ? 500 : 0;
+    opts.trail_decimation = 4;
+    Ensemble *e = ensemble_create(COUNT, &opts);
+    if (!e) {
+        fprintf(stderr, "ensemble_create failed\n");
+        exit(1);
+    }
+    int cfg = ensemble_add_config(e, 1.0, 1.0, 1.5, 1.5, 9.81);
+    for (size_t i = 0; i < COUNT; i++) {
+        PendulumState s = { initial_theta(i), initial_theta(i), 0.0, 0.0 };
+        ensemble_set_pendulum(e, i, cfg, &s, 50, 50, 255);
+    }
+    for (size_t i = 0; i < trails; i++) {
+        ensemble_enable_trail(e, i);
+    }
+    double start = now_seconds();
+    ensemble_step(e, DT, STEPS);
+    double elapsed = now_seconds() - start;
+    *bytes = ensemble_memory_bytes(e);
+    ensemble_destroy(e);
+    return elapsed;
+}
+
+int main(void) {
+    Pendulum *ps = malloc(COUNT * sizeof(Pendulum));
+    if (!ps) return 1;
+    for (size_t i = 0; i < COUNT; i++) {
+        init_pendulum(&ps[i], 1.0, 1.0, 1.5, 1.5, 9.81, initial_theta(i), initial_theta(i), 50, 50, 255);
+    }
+    double start = now_seconds();
+    for (int s = 0; s < STEPS; s++) {
+        for (size_t i = 0; i < COUNT; i++) {
+            update_pendulum(&ps[i], DT, 150.0, 1000, 750);
+        }
+    }
+    double t_struct = now_seconds() - start;
+    free(ps);
+
+    size_t bytes_bare, bytes_trails, bytes_mt;
+    double t_bare = run_ensemble(1, 0, &bytes_bare);
+    double t_trails = run_ensemble(1, COUNT / 10, &bytes_trails);
+    double t_mt = run_ensemble(4, 0, &bytes_mt);
+
+    double steps = (double)COUNT * STEPS;
+    printf("%d pendulums, %d steps\n", COUNT, STEPS);
+    printf("%-32s %14s %12s\n", "layout", "bytes/pendulum", "Msteps/s");
+    printf("%-32s %14zu %12.2f\n", "Pendulum[] + update_pendulum", sizeof(Pendulum), steps / t_struct / 1e6);
+    printf("%-32s %14.1f %12.2f\n", "Ensemble, no trails", (double)bytes_bare / COUNT, steps / t_bare / 1e6);
+    printf("%-32s %14.1f %12.2f\n", "Ensemble, 10% trails every 4th", (double)bytes_trails / COUNT, steps / t_trails / 1e6);
+    printf("%-32s %14.1f %12.2f\n", "Ensemble, 4 threads", (double)bytes_mt / COUNT, steps / t_mt / 1e6);
+    return 0;
+}
@@ -0,0 +1,213 @@
+// bench_io.c - io_uring output and receive paths against blocking write()
+// and recv(): sustained throughput and p99 time the producing thread spends
+// per record, and datagram receive rate and p99 send-to-delivery latency.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "async_io.h"
+
+#define RECORD_SIZE (64 * 1024)
+#define RECORDS 2048                // 128 MiB per run
+#define DATAGRAMS 100000
+#define BURST 32
+#define UDP_PORT 38081
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint64_t percentile(uint64_t *v, size_t n, int pct) {
+    if (n == 0) return 0;
+    qsort(v, n, sizeof(uint64_t), cmp_u64);
+    return v[n * pct / 100];
+}
+
+static int open_scratch(void) {
+    char path[] = "/tmp/pendulum_bench_io_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd >= 0) unlink(path);
+    return fd;
+}
+
+// Writes RECORDS records, each copied from src as a simulator dump would be.
+// Per-record time is what the producing thread is blocked for; throughput
+// includes the final fdatasync().
+static void bench_write(const char *label, bool uring, const char *src, uint64_t *lat) {
+    int fd = open_scratch();
+    if (fd < 0) {
+        perror("mkstemp");
+        exit(1);
+    }
+    AsyncIo *io = NULL;
+    int slot = -1;
+    if (uring) {
+        AsyncIoOptions opts;
+        async_io_default_options(&opts);
+        opts.buffer_size = RECORD_SIZE;
+        io = async_io_create(&opts);
+        if (!io || !async_io_uses_uring(io)) {
+            printf("%-22s io_uring unavailable\n", label);
+            async_io_destroy(io);
+            close(fd);
+            return;
+        }
+        slot = async_io_add_file(io, fd);
+    }
+
+    uint64_t start = now_ns();
+    for (int r = 0; r < RECORDS; r++) {
+        uint64_t t0 = now_ns();
+        if (io) {
+            char *buf = async_io_get_buffer(io, NULL);
+            memcpy(buf, src, RECORD_SIZE);
+            async_io_write(io, slot, buf, RECORD_SIZE);
+        } else {
+            if (write(fd, src, RECORD_SIZE) != RECORD_SIZE) {
+                perror("write");
+                exit(1);
+            }
+        }
+        lat[r] = now_ns() - t0;
+    }
+    if (io) {
+        async_io_flush(io);
+        async_io_destroy(io);
+    }
+    // Sustained means on disk, not just in the page cache.
+    fdatasync(fd);
+    double seconds = (now_ns() - start) * 1e-9;
+    close(fd);
+
+    uint64_t p50 = percentile(lat, RECORDS, 50);
+    uint64_t p99 = percentile(lat, RECORDS, 99);
+    printf("%-22s %10.0f %10.1f %10.1f\n", label,
+           (double)RECORDS * RECORD_SIZE / seconds / (1 << 20), p50 / 1e3, p99 / 1e3);
+}
+
+typedef struct {
+    uint64_t *latency_ns;
+    size_t received;
+} RecvStats;
+
+static void *udp_sender(void *arg) {
+    (void)arg;
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in dest;
+    memset(&dest, 0, sizeof(dest));
+    dest.sin_family = AF_INET;
+    dest.sin_port = htons(UDP_PORT);
+    dest.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    // Paced bursts, so the numbers measure the receive path and not drops.
+    for (int sent = 0; sent < DATAGRAMS; sent++) {
+        uint64_t t = now_ns();
+        sendto(sock, &t, sizeof(t), 0, (struct sockaddr *)&dest, sizeof(dest));
+        if (sent % BURST == BURST - 1) {
+            struct timespec pause = { 0, 20000 };
+            nanosleep(&pause, NULL);
+        }
+    }
+    close(sock);
+    return NULL;
+}
+
+static void record_datagram(const char *data, size_t len, void *ctx) {
+    RecvStats *s = ctx;
+    uint64_t sent;
+    if (len != sizeof(sent) || s->received >= DATAGRAMS) return;
+    memcpy(&sent, data, sizeof(sent));
+    s->latency_ns[s->received++] = now_ns() - sent;
+}
+
+static void bench_recv(const char *label, bool uring, uint64_t *lat) {
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    int rcvbuf = 8 << 20;
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(UDP_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("bind");
+        exit(1);
+    }
+
+    AsyncIo *io = NULL;
+    if (uring) {
+        AsyncIoOptions opts;
+        async_io_default_options(&opts);
+        opts.buffer_size = 4096;
+        opts.buffer_count = 64;
+        io = async_io_create(&opts);
+        if (!io || !async_io_uses_uring(io)) {
+            printf("%-22s io_uring unavailable\n", label);
+            async_io_destroy(io);
+            close(sock);
+            return;
+        }
+        async_io_recv_start(io, async_io_add_file(io, sock), 32);
+    } else {
+        struct timeval tv = { 2, 0 };
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+
+    RecvStats stats = { lat, 0 };
+    pthread_t sender;
+    pthread_create(&sender, NULL, udp_sender, NULL);
+    uint64_t start = now_ns();
+    while (stats.received < DATAGRAMS) {
+        if (io) {
+            if (async_io_recv_poll(io, record_datagram, &stats, 2000) <= 0) break;
+        } else {
+            char buf[64];
+            ssize_t len = recv(sock, buf, sizeof(buf), 0);
+            if (len < 0) break;     // timed out: the rest was dropped
+            record_datagram(buf, (size_t)len, &stats);
+        }
+    }
+    double seconds = (now_ns() - start) * 1e-9;
+    pthread_join(sender, NULL);
+    async_io_destroy(io);
+    close(sock);
+
+    size_t n = stats.received;
+    uint64_t p50 = percentile(lat, n, 50);
+    uint64_t p99 = percentile(lat, n, 99);
+    printf("%-22s %10zu %10.3f %10.1f %10.1f\n", label, n, n / seconds / 1e6, p50 / 1e3, p99 / 1e3);
+}
+
+int main(void) {
+    char *src = malloc(RECORD_SIZE);
+    uint64_t *lat = malloc((RECORDS > DATAGRAMS ? RECORDS : DATAGRAMS) * sizeof(uint64_t));
+    if (!src || !lat) return 1;
+    for (int i = 0; i < RECORD_SIZE; i++) src[i] = (char)(i * 31);
+
+    printf("%d x %d KiB records to a scratch file in /tmp\n", RECORDS, RECORD_SIZE / 1024);
+    printf("%-22s %10s %10s %10s\n", "writer", "MiB/s", "p50 us", "p99 us");
+    bench_write("blocking write()", false, src, lat);
+    bench_write("io_uring WRITE_FIXED", true, src, lat);
+
+    printf("\n%d datagrams over UDP loopback, bursts of %d\n", DATAGRAMS, BURST);
+    printf("%-22s %10s %10s %10s %10s\n", "receiver", "received", "Mmsg/s", "p50 us", "p99 us");
+    bench_recv("blocking recv()", false, lat);
+    bench_recv("io_uring READ_FIXED", true, lat);
+
+    free(lat);
+    free(src);
+    return 0;
+}
@@ -0,0 +1,42 @@
+// bench_parareal.c - Parareal against the serial fine integrator over
+// growing horizons, to show where chaos stops the iteration converging.
+#include <stdio.h>
+#include <math.h>
+
+#include "parareal.h"
+
+int main(void) {
+    PreparedConfig cfg;
+    prepare_config(&cfg, 1.0, 1.0, 1.5, 1.5, 9.81);
+
+    // A low-energy start (regular motion) and the main() start (chaotic).
+    const struct { const char *label; PendulumState s; } starts[] = {
+        { "regular", { 0.3, 0.2, 0.0, 0.0 } },
+        { "chaotic", { M_PI / 2.0, M_PI / 2.0, 0.0, 0.0 } },
+    };
+    const double horizons[] = { 2.0, 5.0, 10.0, 20.0, 40.0 };
+
+    printf("slices=8 threads=8 fine_dt=1e-4 coarse_dt=0.1; speedup needs as many free cores\n");
+    printf("%-8s %6s %5s %9s %10s %11s %8s %8s %s\n",
+           "start", "t_end", "iter", "defect", "conv_until", "serial_ms", "para_ms", "speedup", "verdict");
+    for (size_t i = 0; i < sizeof(starts) / sizeof(starts[0]); i++) {
+        for (size_t h = 0; h < sizeof(horizons) / sizeof(horizons[0]); h++) {
+            PararealOptions opts;
+            parareal_default_options(&opts, horizons[h]);
+            opts.fine_dt = 1e-4;
+            opts.coarse_dt = 0.1;
+            opts.measure_serial = true;
+
+            PararealResult r;
+            if (!parareal_solve(&cfg, &starts[i].s, &opts, &r)) {
+                fprintf(stderr, "parareal_solve failed\n");
+                return 1;
+            }
+            printf("%-8s %6.1f %5d %9.1e %10.2f %11.1f %8.1f %8.2f %s\n",
+                   starts[i].label, horizons[h], r.iterations, r.defect, r.converged_until,
+                   r.serial_seconds * 1e3, r.parallel_seconds * 1e3, r.speedup,
+                   r.chaos_limited ? "use serial" : "ok");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,109 @@
+// bench_precision.c - throughput and accuracy of the double, float and
+// mixed-precision integrators on a shared-parameter ensemble.
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "arithmetic.h"
+#include "pendulum.h"
+
+#define ENSEMBLE_SIZE 4096
+#define STEPS 1000
+#define DT 0.01
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Initial angles spread over a small window around the upright-ish start
+// used by main(), so every member is in the chaotic regime.
+static double initial_theta(size_t i) {
+    return M_PI / 2.0 + 1e-3 * (double)i / ENSEMBLE_SIZE;
+}
+
+// True once the second arm has passed over the top.
+static int first_flip(double theta2) {
+    return fabs(theta2) > M_PI;
+}
+
+int main(void) {
+    const double m1 = 1.0, m2 = 1.0, l1 = 1.5, l2 = 1.5, g = 9.81;
+    size_t n = ENSEMBLE_SIZE;
+
+    double *d_t1 = malloc(n * sizeof(double)), *d_t2 = malloc(n * sizeof(double));
+    double *d_w1 = malloc(n * sizeof(double)), *d_w2 = malloc(n * sizeof(double));
+    double *x_t1 = malloc(n * sizeof(double)), *x_t2 = malloc(n * sizeof(double));
+    double *x_w1 = malloc(n * sizeof(double)), *x_w2 = malloc(n * sizeof(double));
+    float *f_t1 = malloc(n * sizeof(float)), *f_t2 = malloc(n * sizeof(float));
+    float *f_w1 = malloc(n * sizeof(float)), *f_w2 = malloc(n * sizeof(float));
+    int *d_flip = malloc(n * sizeof(int)), *x_flip = malloc(n * sizeof(int)), *f_flip = malloc(n * sizeof(int));
+    if (!d_t1 || !d_t2 || !d_w1 || !d_w2 || !x_t1 || !x_t2 || !x_w1 || !x_w2 ||
+        !f_t1 || !f_t2 || !f_w1 || !f_w2 || !d_flip || !x_flip || !f_flip) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        d_t1[i] = x_t1[i] = initial_theta(i);
+        d_t2[i] = x_t2[i] = initial_theta(i);
+        d_w1[i] = d_w2[i] = x_w1[i] = x_w2[i] = 0.0;
+        f_t1[i] = f_t2[i] = (float)initial_theta(i);
+        f_w1[i] = f_w2[i] = 0.0f;
+        d_flip[i] = x_flip[i] = f_flip[i] = -1;
+    }
+
+    double t_double = 0.0, t_mixed = 0.0, t_float = 0.0;
+    double err_mixed_1s = 0.0, err_float_1s = 0.0;
+
+    for (int s = 0; s < STEPS; s++) {
+        double t0 = now_seconds();
+        compute_batch(d_t1, d_t2, d_w1, d_w2, n, m1, m2, l1, l2, g, DT);
+        double t1 = now_seconds();
+        compute_batch_mixed(x_t1, x_t2, x_w1, x_w2, n, m1, m2, l1, l2, g, DT);
+        double t2 = now_seconds();
+        compute_batch_f(f_t1, f_t2, f_w1, f_w2, n,
+                        (float)m1, (float)m2, (float)l1, (float)l2, (float)g, (float)DT);
+        double t3 = now_seconds();
+        t_double += t1 - t0;
+        t_mixed += t2 - t1;
+        t_float += t3 - t2;
+
+        for (size_t i = 0; i < n; i++) {
+            if (d_flip[i] < 0 && first_flip(d_t2[i])) d_flip[i] = s;
+            if (x_flip[i] < 0 && first_flip(x_t2[i])) x_flip[i] = s;
+            if (f_flip[i] < 0 && first_flip(f_t2[i])) f_flip[i] = s;
+        }
+
+        if (s == (int)(1.0 / DT) - 1) {
+            for (size_t i = 0; i < n; i++) {
+                err_mixed_1s = fmax(err_mixed_1s, fabs(x_t2[i] - d_t2[i]));
+                err_float_1s = fmax(err_float_1s, fabs(f_t2[i] - d_t2[i]));
+            }
+        }
+    }
+
+    size_t mixed_agree = 0, float_agree = 0;
+    for (size_t i = 0; i < n; i++) {
+        // Flip times count as agreeing within 0.1 s of simulated time.
+        if ((d_flip[i] < 0) == (x_flip[i] < 0) && abs(d_flip[i] - x_flip[i]) <= 10) mixed_agree++;
+        if ((d_flip[i] < 0) == (f_flip[i] < 0) && abs(d_flip[i] - f_flip[i]) <= 10) float_agree++;
+    }
+
+    double steps = (double)n * STEPS;
+    printf("ensemble=%zu steps=%d dt=%.3f\n", n, STEPS, DT);
+    printf("%-8s %12s %10s %14s %16s\n", "mode", "Msteps/s", "speedup", "max|dth2|@1s", "flip agreement");
+    printf("%-8s %12.2f %10.2f %14s %15s\n", "double", steps / t_double / 1e6, 1.0, "-", "-");
+    printf("%-8s %12.2f %10.2f %14.3e %15.1f%%\n", "mixed", steps / t_mixed / 1e6, t_double / t_mixed,
+           err_mixed_1s, 100.0 * mixed_agree / n);
+    printf("%-8s %12.2f %10.2f %14.3e %15.1f%%\n", "float", steps / t_float / 1e6, t_double / t_float,
+           err_float_1s, 100.0 * float_agree / n);
+
+    free(d_t1); free(d_t2); free(d_w1); free(d_w2);
+    free(x_t1); free(x_t2); free(x_w1); free(x_w2);
+    free(f_t1); free(f_t2); free(f_w1); free(f_w2);
+    free(d_flip); free(x_flip); free(f_flip);
+    return 0;
+}
@@ -0,0 +1,145 @@
+// bench_publisher.c - sender CPU time per batch as loopback subscribers are
+// added: the publisher (serialize once, one sendmmsg) against a sendto()
+// loop that serializes for every subscriber, and one multicast group joined
+// by all of them.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "pendulum.h"
+#include "publisher.h"
+
+#define MAX_SUBS 64
+#define BATCHES 2000
+#define BATCH_STATES 32     // one frame of the viewer at its largest
+#define GROUP "239.255.77.1"
+
+static double cpu_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Receivers are drained between batches, outside the timed region.
+static void drain(const int *socks, int n) {
+    char buf[PUBLISH_MAX_DATAGRAM];
+    for (int i = 0; i < n; i++) {
+        while (recv(socks[i], buf, sizeof(buf), MSG_DONTWAIT) > 0) {}
+    }
+}
+
+static double naive_send(int sock, const struct sockaddr_in *addrs, int n,
+                         const PendulumState *states, uint64_t sequence) {
+    double start = cpu_seconds();
+    for (int i = 0; i < n; i++) {
+        char buf[PUBLISH_MAX_DATAGRAM];
+        PublishHeader h = { { 0 }, PUBLISH_VERSION, PUBLISH_STATE, BATCH_STATES, sequence, 0.0 };
+        memcpy(h.magic, PUBLISH_MAGIC, 4);
+        memcpy(buf, &h, sizeof(h));
+        memcpy(buf + sizeof(h), states, sizeof(PendulumState) * BATCH_STATES);
+        sendto(sock, buf, sizeof(h) + sizeof(PendulumState) * BATCH_STATES, 0,
+               (const struct sockaddr *)&addrs[i], sizeof(addrs[i]));
+    }
+    return cpu_seconds() - start;
+}
+
+// n sockets on one port, all members of GROUP. Returns the port, or -1.
+static int join_group(int *socks, int n) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    struct ip_mreq mreq;
+    memset(&mreq, 0, sizeof(mreq));
+    inet_pton(AF_INET, GROUP, &mreq.imr_multiaddr);
+    mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+    for (int i = 0; i < n; i++) {
+        int reuse = 1;
+        socklen_t len = sizeof(addr);
+        socks[i] = socket(AF_INET, SOCK_DGRAM, 0);
+        setsockopt(socks[i], SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (bind(socks[i], (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+            getsockname(socks[i], (struct sockaddr *)&addr, &len) < 0 ||
+            setsockopt(socks[i], IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+            for (int k = 0; k <= i; k++) close(socks[k]);
+            return -1;
+        }
+    }
+    return ntohs(addr.sin_port);
+}
+
+int main(void) {
+    static int socks[MAX_SUBS];
+    static struct sockaddr_in addrs[MAX_SUBS];
+    for (int i = 0; i < MAX_SUBS; i++) {
+        socks[i] = socket(AF_INET, SOCK_DGRAM, 0);
+        addrs[i].sin_family = AF_INET;
+        addrs[i].sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addrs[i]);
+        if (socks[i] < 0 || bind(socks[i], (struct sockaddr *)&addrs[i], len) < 0 ||
+            getsockname(socks[i], (struct sockaddr *)&addrs[i], &len) < 0) {
+            perror("bench_publisher socket");
+            return 1;
+        }
+    }
+    int naive_sock = socket(AF_INET, SOCK_DGRAM, 0);
+
+    PendulumState states[BATCH_STATES];
+    for (int k = 0; k < BATCH_STATES; k++) states[k] = (PendulumState){ k, -k, 0.5, 0.25 };
+
+    printf("%d batches of %d states (%zu-byte datagram)\n", BATCHES, BATCH_STATES,
+           sizeof(PublishHeader) + sizeof(states));
+    printf("subs   publisher us/batch  us/datagram   sendto loop us/batch  us/datagram"
+           "   multicast us/batch\n");
+    for (int n = 1; n <= MAX_SUBS; n *= 2) {
+        Publisher *pub = publisher_create();
+        if (!pub) return 1;
+        for (int i = 0; i < n; i++) {
+            char dest[32];
+            snprintf(dest, sizeof(dest), "127.0.0.1:%d", ntohs(addrs[i].sin_port));
+            publisher_add(pub, dest, PUBLISH_STATE, 1);
+        }
+        double t_pub = 0.0, t_naive = 0.0;
+        for (int b = 0; b < BATCHES; b++) {
+            double start = cpu_seconds();
+            publisher_send(pub, PUBLISH_STATE, b, states, BATCH_STATES);
+            t_pub += cpu_seconds() - start;
+            drain(socks, n);
+            t_naive += naive_send(naive_sock, addrs, n, states, (uint64_t)b * BATCH_STATES);
+            drain(socks, n);
+        }
+        publisher_destroy(pub);
+
+        // The kernel copies a group datagram to each member, on loopback
+        // still in the sender's context.
+        static int members[MAX_SUBS];
+        double t_group = -1.0;
+        int port = join_group(members, n);
+        pub = publisher_create();
+        char dest[32];
+        snprintf(dest, sizeof(dest), GROUP ":%d", port);
+        if (pub && port > 0 && publisher_add(pub, dest, PUBLISH_STATE, 1) >= 0) {
+            t_group = 0.0;
+            for (int b = 0; b < BATCHES; b++) {
+                double start = cpu_seconds();
+                publisher_send(pub, PUBLISH_STATE, b, states, BATCH_STATES);
+                t_group += cpu_seconds() - start;
+                drain(members, n);
+            }
+        }
+        publisher_destroy(pub);
+        for (int i = 0; port > 0 && i < n; i++) close(members[i]);
+
+        printf("%4d   %18.2f  %11.2f   %20.2f  %11.2f   %18.2f\n", n,
+               1e6 * t_pub / BATCHES, 1e6 * t_pub / BATCHES / n,
+               1e6 * t_naive / BATCHES, 1e6 * t_naive / BATCHES / n,
+               t_group < 0.0 ? -1.0 : 1e6 * t_group / BATCHES);
+    }
+    close(naive_sock);
+    for (int i = 0; i < MAX_SUBS; i++) close(socks[i]);
+    return 0;
+}
@@ -0,0 +1,108 @@
+// bench_trajectory.c - compression ratio and encode/decode throughput of the
+// trajectory recorder on an ensemble, lossless and at two quantization steps.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "arithmetic.h"
+#include "trajectory.h"
+
+#define PENDULUMS 256
+#define SAMPLES 4000
+#define DT 0.01
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void run(const char *name, double quantum, double *t1, double *t2, double *w1, double *w2) {
+    TrajectoryOptions opts;
+    trajectory_default_options(&opts);
+    for (int c = 0; c < TRAJECTORY_CHANNELS; c++) opts.quantum[c] = quantum;
+    char path[] = "/tmp/bench_trajectory_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) return;
+    close(fd);
+
+    // Integration is kept out of the timing: the states are recorded first.
+    size_t n = (size_t)PENDULUMS * SAMPLES;
+    double *a = malloc(4 * n * sizeof(double));
+    if (!a) return;
+    for (int s = 0; s < SAMPLES; s++) {
+        double *row = a + 4 * (size_t)s * PENDULUMS;
+        for (int p = 0; p < PENDULUMS; p++) {
+            row[p] = t1[p];
+            row[PENDULUMS + p] = t2[p];
+            row[2 * PENDULUMS + p] = w1[p];
+            row[3 * PENDULUMS + p] = w2[p];
+        }
+        compute_batch(t1, t2, w1, w2, PENDULUMS, 1.0, 2.0, 1.5, 1.0, 9.81, DT);
+    }
+
+    double start = now_seconds();
+    TrajectoryWriter *w = trajectory_writer_open(path, PENDULUMS, 0.0, DT, &opts);
+    if (!w) {
+        free(a);
+        return;
+    }
+    for (int s = 0; s < SAMPLES; s++) {
+        double *row = a + 4 * (size_t)s * PENDULUMS;
+        trajectory_writer_append_soa(w, row, row + PENDULUMS, row + 2 * PENDULUMS,
+                                     row + 3 * PENDULUMS);
+    }
+    uint64_t bytes = trajectory_writer_bytes(w);
+    trajectory_writer_close(w);
+    double t_encode = now_seconds() - start;
+
+    TrajectoryReader *r = trajectory_reader_open(path);
+    PendulumState *states = malloc(PENDULUMS * sizeof(PendulumState));
+    double max_err = 0.0;
+    start = now_seconds();
+    for (int s = 0; r && states && s < SAMPLES; s++) {
+        trajectory_reader_sample(r, (uint64_t)s, states);
+    }
+    double t_decode = now_seconds() - start;
+    for (int s = 0; r && states && s < SAMPLES; s += 97) {
+        trajectory_reader_sample(r, (uint64_t)s, states);
+        double *row = a + 4 * (size_t)s * PENDULUMS;
+        for (int p = 0; p < PENDULUMS; p++) {
+            double e = fabs(states[p].theta2 - row[PENDULUMS + p]);
+            if (e > max_err) max_err = e;
+        }
+    }
+    trajectory_reader_close(r);
+    unlink(path);
+
+    double raw = 4.0 * n * sizeof(double);
+    printf("%-10s ratio %5.2fx  %5.1f bits/value  encode %7.1f MB/s  decode %7.1f MB/s"
+           "  %5.1f ns/value  max err %.1e\n",
+           name, raw / bytes, 8.0 * bytes / (4.0 * n), raw / t_encode / 1e6,
+           raw / t_decode / 1e6, t_encode / (4.0 * n) * 1e9, max_err);
+    free(states);
+    free(a);
+}
+
+int main(void) {
+    static double t1[PENDULUMS], t2[PENDULUMS], w1[PENDULUMS], w2[PENDULUMS];
+    const struct { const char *name; double quantum; } modes[] = {
+        { "lossless", 0.0 }, { "q=1e-9", 1e-9 }, { "q=1e-6", 1e-6 },
+    };
+    printf("%d pendulums x %d samples, raw %.1f MB\n", PENDULUMS, SAMPLES,
+           4.0 * PENDULUMS * SAMPLES * sizeof(double) / 1e6);
+    for (int m = 0; m < 3; m++) {
+        for (int i = 0; i < PENDULUMS; i++) {
+            t1[i] = 1.5 + i * 1e-3;
+            t2[i] = 1.5 - i * 1e-3;
+            w1[i] = 0.0;
+            w2[i] = 0.0;
+        }
+        run(modes[m].name, modes[m].quantum, t1, t2, w1, w2);
+    }
+    // One ensemble step is 4 values per pendulum; at 8 Msteps/s the recorder
+    // has to stay under about 30 ns per value.
+    return 0;
+}
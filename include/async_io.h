@@ -0,0 +1,66 @@
+// async_io.h - batched file writes and socket receives on io_uring, with a
+// blocking fallback, so output does not stall the thread doing the work.
+#ifndef ASYNC_IO_H
+#define ASYNC_IO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define ASYNC_IO_MAX_FILES 8
+
+typedef struct AsyncIo AsyncIo;
+
+typedef struct {
+    unsigned queue_depth;       // submission queue entries
+    unsigned buffer_count;      // registered buffers, shared by reads and writes
+    size_t buffer_size;
+    unsigned submit_batch;      // requests queued before entering the kernel
+    bool force_blocking;        // also forced by PENDULUM_IO=blocking
+} AsyncIoOptions;
+
+void async_io_default_options(AsyncIoOptions *opts);
+
+// Sets up io_uring with registered buffers and a fixed-file table. Falls back
+// to plain write()/recv() when io_uring is unavailable or disabled. Returns
+// NULL only if memory allocation fails.
+AsyncIo *async_io_create(const AsyncIoOptions *opts);
+
+// Flushes pending writes, then releases the ring. Registered fds are not closed.
+void async_io_destroy(AsyncIo *io);
+
+bool async_io_uses_uring(const AsyncIo *io);
+const char *async_io_backend(const AsyncIo *io);
+
+// Registers fd in the fixed-file table and returns its slot, or -1.
+int async_io_add_file(AsyncIo *io, int fd);
+
+// Output. A buffer from async_io_get_buffer() belongs to the caller until it
+// is passed to async_io_write(); after that it must not be touched. Writes to
+// a regular file land at consecutive offsets from the file position at
+// registration. Writes to pipes, terminals and O_APPEND files are issued one
+// at a time per file to keep their order.
+char *async_io_get_buffer(AsyncIo *io, size_t *capacity);
+bool async_io_write(AsyncIo *io, int slot, char *buf, size_t len);
+
+// Copies data into as many buffers as needed and queues them.
+bool async_io_write_copy(AsyncIo *io, int slot, const void *data, size_t len);
+
+// Submits everything queued and waits until all writes have completed.
+// Regular files are left positioned after the last write.
+bool async_io_flush(AsyncIo *io);
+
+// First errno reported by a completed request, 0 if none failed.
+int async_io_error(const AsyncIo *io);
+
+// Input. Keeps depth reads posted on the socket in slot (at most half the
+// buffers, the rest stay available for output); every completed datagram is
+// passed to fn and its buffer is re-armed.
+typedef void (*AsyncIoRecvFn)(const char *data, size_t len, void *ctx);
+
+bool async_io_recv_start(AsyncIo *io, int slot, unsigned depth);
+
+// Waits up to timeout_ms (negative: forever) for datagrams and delivers all
+// that are ready. Returns the number delivered, or -1 on a socket error.
+int async_io_recv_poll(AsyncIo *io, AsyncIoRecvFn fn, void *ctx, int timeout_ms);
+
+#endif // ASYNC_IO_H
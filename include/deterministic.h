@@ -0,0 +1,76 @@
+// deterministic.h
+#ifndef DETERMINISTIC_H
+#define DETERMINISTIC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sha256.h"
+
+// Bit-reproducible integration. Everything here is built from IEEE-754
+// +, -, *, / in a fixed order, compiled without FMA contraction, with its
+// own sin/cos instead of the platform libm. The same inputs give the same
+// bits for any thread count, optimization level, target ISA (x86-64
+// SSE2/AVX, AArch64) or C library. 32-bit x87 builds are not covered.
+
+// Pendulums per partition block. Work is split in whole blocks and every
+// reduction adds per-block partials in block order.
+#define DETERMINISTIC_BLOCK 256
+
+// fdlibm-style sin/cos, within 1 ulp of the true value. Arguments up to
+// about 1.6e6 rad are reduced exactly; beyond that the reduction is
+// reproducible but less accurate.
+double det_sin(double x);
+double det_cos(double x);
+
+// Same RK4 step and equations as compute(), evaluated reproducibly.
+void compute_deterministic(
+    double theta1,
+    double theta2,
+    double omega1,
+    double omega2,
+    double m1,
+    double m2,
+    double l1,
+    double l2,
+    double g,
+    double dt,
+    double *new_theta1,
+    double *new_theta2,
+    double *new_omega1,
+    double *new_omega2
+);
+
+// Advances n pendulums (SoA, in place) by steps steps on up to threads
+// threads. Bit-identical to calling compute_deterministic() on each
+// pendulum in turn.
+void compute_batch_deterministic(
+    double *theta1, double *theta2,
+    double *omega1, double *omega2,
+    size_t n,
+    double m1, double m2,
+    double l1, double l2,
+    double g, double dt,
+    int steps, int threads
+);
+
+// Total energy of the batch, summed per block and then over blocks in index
+// order, so the result does not depend on threads.
+double deterministic_energy(
+    const double *theta1, const double *theta2,
+    const double *omega1, const double *omega2,
+    size_t n,
+    double m1, double m2,
+    double l1, double l2,
+    double g, int threads
+);
+
+// SHA-256 of the states in index order, each double as little-endian bytes
+// (theta1, theta2, omega1, omega2), for comparing runs across machines.
+void deterministic_hash(
+    const double *theta1, const double *theta2,
+    const double *omega1, const double *omega2,
+    size_t n,
+    uint8_t hash[SHA256_BLOCK_SIZE]
+);
+
+#endif // DETERMINISTIC_H
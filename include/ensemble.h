@@ -0,0 +1,52 @@
+// ensemble.h - many pendulums stepped together, with hot state, cold
+// per-pendulum data and trails kept in separate arenas.
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "pendulum.h"
+
+#define ENSEMBLE_MAX_CONFIGS 16
+
+typedef struct {
+    int threads;                // worker threads, each owns a fixed slice
+    size_t trail_length;        // points per trail ring; 0 disables trails
+    unsigned trail_decimation;  // record a trail point every N steps
+} EnsembleOptions;
+
+typedef struct Ensemble Ensemble;
+
+void ensemble_default_options(EnsembleOptions *opts);
+
+// Pendulums start at rest hanging down, using configuration 0, which must be
+// added before stepping. Returns NULL on invalid options or if memory or
+// threads cannot be obtained.
+Ensemble *ensemble_create(size_t count, const EnsembleOptions *opts);
+void ensemble_destroy(Ensemble *e);
+
+size_t ensemble_count(const Ensemble *e);
+
+// Physical parameters are shared: add each distinct configuration once and
+// point pendulums at it. Returns the configuration id, or -1 if full.
+int ensemble_add_config(Ensemble *e, double m1, double m2, double l1, double l2, double g);
+
+bool ensemble_set_pendulum(Ensemble *e, size_t index, int config, const PendulumState *state,
+                           unsigned char r, unsigned char g, unsigned char b);
+void ensemble_get_state(const Ensemble *e, size_t index, PendulumState *out);
+
+// Trails are opt-in per pendulum; their storage is only allocated the first
+// time a pendulum asks for one.
+bool ensemble_enable_trail(Ensemble *e, size_t index);
+
+// Copies up to max_points of the most recent positions of bob 2 (meters,
+// pivot at the origin, y up) as x,y pairs, oldest first. Returns the number
+// of points written.
+size_t ensemble_trail(const Ensemble *e, size_t index, float *xy, size_t max_points);
+
+void ensemble_step(Ensemble *e, double dt, size_t steps);
+
+// Bytes of memory actually reserved for pendulum data across all arenas.
+size_t ensemble_memory_bytes(const Ensemble *e);
+
+#endif
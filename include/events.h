@@ -0,0 +1,52 @@
+// events.h - locating events (section crossings, flips) between RK4 steps
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "arithmetic.h"
+#include "pendulum.h"
+
+// An event happens where fn changes sign. accept, if set, filters crossings
+// after they are located (e.g. keep theta1 = 0 but not theta1 = pi).
+typedef double (*EventFunction)(const PendulumState *s, void *ctx);
+typedef bool (*EventFilter)(const PendulumState *s, void *ctx);
+
+typedef enum {
+    EVENT_FALLING = -1,
+    EVENT_EITHER = 0,
+    EVENT_RISING = 1
+} EventDirection;
+
+typedef struct {
+    EventFunction fn;
+    EventFilter accept;
+    EventDirection direction;
+    void *ctx;
+} EventSpec;
+
+typedef struct {
+    int event;              // index into the EventSpec array
+    double t;
+    PendulumState state;
+} EventHit;
+
+// Advances *state by one RK4 step of dt starting at time t and reports every
+// event crossed during the step, in time order. Crossings are located by
+// root-finding on a cubic Hermite interpolant of the step, so the event time
+// is accurate to the integrator's order without shrinking dt. Returns the
+// number of hits written (at most max_hits).
+size_t event_step(const PreparedConfig *cfg, PendulumState *state, double t, double dt,
+                  const EventSpec *events, size_t event_count,
+                  EventHit *hits, size_t max_hits);
+
+// theta1 = 0 (mod 2*pi): use with EVENT_RISING and event_accept_theta1_down
+// for the classic section with omega1 > 0.
+double event_theta1_section(const PendulumState *s, void *ctx);
+bool event_accept_theta1_down(const PendulumState *s, void *ctx);
+
+// Arm 1 or arm 2 passing over the top (theta = pi mod 2*pi), either direction.
+double event_flip1(const PendulumState *s, void *ctx);
+double event_flip2(const PendulumState *s, void *ctx);
+
+#endif
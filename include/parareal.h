@@ -0,0 +1,51 @@
+// parareal.h
+#ifndef PARAREAL_H
+#define PARAREAL_H
+
+#include <stdbool.h>
+#include "arithmetic.h"
+#include "pendulum.h"
+
+// Parareal splits [0, t_end] into slices that are propagated in parallel by
+// the fine (accurate) integrator, then corrected serially with a cheap coarse
+// one, until the slice boundaries stop moving. Chaos makes the coarse
+// predictor useless after a few Lyapunov times, so long horizons may need
+// close to one iteration per slice, at which point it is slower than serial.
+typedef struct {
+    double t_end;
+    int slices;
+    int threads;
+    double fine_dt;
+    double coarse_dt;
+    double tolerance;       // max change of any boundary state between iterations
+    int max_iterations;     // 0 means slices
+    bool measure_serial;    // also time a plain serial fine run for the speedup
+} PararealOptions;
+
+typedef struct {
+    PendulumState final_state;
+    int iterations;
+    bool converged;
+    double defect;              // boundary change in the last iteration
+    double converged_until;     // boundaries up to this time stopped moving
+    double parallel_seconds;
+    double serial_seconds;      // 0 unless measure_serial was set
+    double speedup;             // serial / parallel, 0 unless measured
+    double iteration_bound;     // min(threads, slices) / iterations, best case
+    bool chaos_limited;         // not worth it: use the serial path instead
+} PararealResult;
+
+void parareal_default_options(PararealOptions *opts, double t_end);
+
+// Serial fine reference: integrate from initial to t_end with fine_dt.
+void parareal_serial(const PreparedConfig *cfg, const PendulumState *initial,
+                     double t_end, double dt, PendulumState *out);
+
+// Returns false only on invalid options or allocation failure; lack of
+// convergence is reported through result. After `slices` iterations the final
+// state equals the serial one whatever the defect says, but by then nothing
+// was gained over parareal_serial().
+bool parareal_solve(const PreparedConfig *cfg, const PendulumState *initial,
+                    const PararealOptions *opts, PararealResult *result);
+
+#endif
@@ -3,6 +3,7 @@
 #define PENDULUM_H
 
 #include <stdbool.h>
+#include "arithmetic.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -10,6 +11,13 @@
 
 #define TRAIL_LENGTH 500 
 
+typedef struct {
+    double theta1;
+    double theta2;
+    double omega1;
+    double omega2;
+} PendulumState;
+
 typedef struct {
     double m1;          
     double m2;          
@@ -40,6 +48,8 @@ void init_pendulum(Pendulum *p,
 
 void update_pendulum(Pendulum *p, double dt, double pixels_per_meter, int screen_width, int screen_height);
 
+void prepare_pendulum_config(const Pendulum *p, PreparedConfig *cfg);
+
 void set_pendulum_position_ik(Pendulum *p, double target_x, double target_y, 
                               double pivot_x_screen, double pivot_y_screen, double pixels_per_meter);
 
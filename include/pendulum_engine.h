@@ -0,0 +1,83 @@
+// pendulum_engine.h - embeddable C API for the pendulum_core library
+#ifndef PENDULUM_ENGINE_H
+#define PENDULUM_ENGINE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PENDULUM_ENGINE_API_VERSION 1
+
+// Opaque simulation handle: an ensemble of pendulums sharing one set of
+// physical parameters and one time step. All storage is allocated by
+// pendulum_sim_create(); stepping, get/set and extraction never allocate and
+// only read or write caller-provided buffers.
+typedef struct PendulumSim PendulumSim;
+
+typedef struct {
+    double m1;
+    double m2;
+    double l1;
+    double l2;
+    double g;
+} PendulumSimParams;
+
+typedef struct {
+    double theta1;
+    double theta2;
+    double omega1;
+    double omega2;
+} PendulumSimState;
+
+typedef enum {
+    PENDULUM_SIM_OK = 0,
+    PENDULUM_SIM_EINVAL = -1,   // NULL handle/buffer or non-physical parameters
+    PENDULUM_SIM_ERANGE = -2    // index range outside the ensemble
+} PendulumSimStatus;
+
+// Derived quantities for pendulum_sim_extract(). Positions are in meters
+// with y pointing up and the pivot at the origin.
+typedef enum {
+    PENDULUM_SIM_THETA1,
+    PENDULUM_SIM_THETA2,
+    PENDULUM_SIM_OMEGA1,
+    PENDULUM_SIM_OMEGA2,
+    PENDULUM_SIM_BOB1_X,
+    PENDULUM_SIM_BOB1_Y,
+    PENDULUM_SIM_BOB2_X,
+    PENDULUM_SIM_BOB2_Y,
+    PENDULUM_SIM_ENERGY
+} PendulumSimQuantity;
+
+unsigned pendulum_sim_api_version(void);
+
+// Returns NULL on invalid arguments or allocation failure. Every pendulum
+// starts at rest hanging straight down.
+PendulumSim *pendulum_sim_create(size_t count, const PendulumSimParams *params, double dt);
+void pendulum_sim_destroy(PendulumSim *sim);
+
+size_t pendulum_sim_count(const PendulumSim *sim);
+double pendulum_sim_time(const PendulumSim *sim);
+
+PendulumSimStatus pendulum_sim_set_params(PendulumSim *sim, const PendulumSimParams *params);
+PendulumSimStatus pendulum_sim_set_dt(PendulumSim *sim, double dt);
+
+PendulumSimStatus pendulum_sim_set_state(PendulumSim *sim, size_t first, size_t count,
+                                         const PendulumSimState *states);
+PendulumSimStatus pendulum_sim_get_state(const PendulumSim *sim, size_t first, size_t count,
+                                         PendulumSimState *out);
+
+// Advances every pendulum by `steps` RK4 steps of the configured dt.
+PendulumSimStatus pendulum_sim_step(PendulumSim *sim, size_t steps);
+
+// Writes `count` values of `quantity` for pendulums [first, first + count).
+PendulumSimStatus pendulum_sim_extract(const PendulumSim *sim, PendulumSimQuantity quantity,
+                                       size_t first, size_t count, double *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
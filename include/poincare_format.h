@@ -0,0 +1,32 @@
+// poincare_format.h - binary layout written by tools/poincare
+#ifndef POINCARE_FORMAT_H
+#define POINCARE_FORMAT_H
+
+#include <stdint.h>
+
+#define POINCARE_MAGIC "PCS1"
+#define POINCARE_VERSION 1
+
+// File layout (little-endian, as written by the host):
+//   PoincareHeader
+//   double energies[header.energy_count]
+//   PoincarePoint points[] until end of file, in no particular order
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t energy_count;
+    uint32_t orbits_per_energy;
+    double m1, m2, l1, l2, g;
+    double t_end;
+    double dt;
+} PoincareHeader;
+
+// One crossing of theta1 = 0 with omega1 > 0, stored as (theta2, omega2).
+typedef struct {
+    uint16_t energy;        // index into the energies array
+    uint16_t orbit;
+    float theta2;           // wrapped to [-pi, pi]
+    float omega2;
+} PoincarePoint;
+
+#endif
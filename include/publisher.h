@@ -0,0 +1,85 @@
+// publisher.h - fan-out of pendulum state and random streams over UDP to
+// several unicast destinations or multicast groups.
+#ifndef PUBLISHER_H
+#define PUBLISHER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PUBLISH_MAGIC "PPB1"
+#define PUBLISH_VERSION 1
+
+// Largest datagram sent, so that batches are not IP-fragmented on Ethernet.
+#define PUBLISH_MAX_DATAGRAM 1472
+#define PUBLISHER_MAX_SUBSCRIBERS 256
+
+// Topics, also used as bits of a subscriber's topic mask.
+typedef enum {
+    PUBLISH_STATE = 1u << 0,    // PendulumState records
+    PUBLISH_SAMPLES = 1u << 1,  // PublishSample records, the inputs of the hash
+    PUBLISH_RANDOM = 1u << 2,   // uint64_t random words
+    PUBLISH_TEXT = 1u << 3,     // the same words as bare decimal text, see below
+} PublishTopic;
+
+// Binary topics; PUBLISH_TEXT has to be asked for by name.
+#define PUBLISH_ALL (PUBLISH_STATE | PUBLISH_SAMPLES | PUBLISH_RANDOM)
+
+typedef struct {
+    double x1, y1, x2, y2;
+} PublishSample;
+
+// Every datagram of a binary topic starts with this header, followed by
+// count records of the topic (little-endian, as written by the host).
+// sequence numbers records, not datagrams, per topic, so a receiver can tell
+// drops from decimation.
+typedef struct {
+    char magic[4];
+    uint8_t version;
+    uint8_t topic;
+    uint16_t count;
+    uint64_t sequence;
+    double time;            // simulation time of the batch
+} PublishHeader;
+
+// PUBLISH_TEXT keeps the format the viewer sent before the publisher: one
+// uint64_t record per datagram, printed in decimal, with no header.
+
+typedef struct Publisher Publisher;
+
+Publisher *publisher_create(void);
+void publisher_destroy(Publisher *pub);
+
+// Adds a destination "host:port". topics is a mask of PublishTopic; a
+// decimation of n sends every n-th batch of each topic. Multicast groups
+// are sent with TTL 1 and loopback enabled. Returns the subscriber index,
+// or -1.
+int publisher_add(Publisher *pub, const char *dest, unsigned topics, unsigned decimation);
+
+// Adds destinations from a spec such as
+// "239.0.0.1:9000/state,samples/6;127.0.0.1:12345/random" where topics
+// (state, samples, random, text, all) default to all and decimation to 1.
+bool publisher_add_spec(Publisher *pub, const char *spec);
+
+int publisher_subscribers(const Publisher *pub);
+
+// True if some subscriber takes topic, so callers can skip building it.
+bool publisher_wants(const Publisher *pub, PublishTopic topic);
+
+// Publishes count records as one batch. The batch is serialized once into
+// as many datagrams as it needs, and they are sent to every subscriber due
+// this batch with a single sendmmsg() where available. Returns false on a
+// send error.
+bool publisher_send(Publisher *pub, PublishTopic topic, double time,
+                    const void *records, size_t count);
+
+uint64_t publisher_datagrams_sent(const Publisher *pub);
+
+// Record size of a topic, 0 if unknown.
+size_t publish_record_size(unsigned topic);
+
+// Validates a received datagram and points records at its payload.
+bool publish_decode(const void *data, size_t len, PublishHeader *header,
+                    const void **records);
+
+#endif // PUBLISHER_H
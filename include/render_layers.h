@@ -0,0 +1,55 @@
+// render_layers.h - cached render layers composited once per frame
+#ifndef RENDER_LAYERS_H
+#define RENDER_LAYERS_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+#define LAYER_MAX_PENDING_SEGMENTS 64
+
+// Steps between fades of the trail layer and how much alpha each fade
+// removes. 24/255 every 8 steps leaves about 0.2% of a segment after
+// TRAIL_LENGTH steps, close to the old linear fade over the trail buffer.
+#define TRAIL_FADE_INTERVAL 8
+#define TRAIL_FADE_ALPHA 24
+
+typedef struct {
+    int x0, y0, x1, y1;
+    unsigned char r, g, b;
+} TrailSegment;
+
+// The background layer (clear color and grid) is rendered once into a
+// target texture. The trail layer persists between frames: new segments are
+// drawn into it and it is faded in place, instead of redrawing the whole
+// trail every frame. Segments are queued so the render target only switches
+// once per frame.
+typedef struct {
+    SDL_Renderer *renderer;
+    SDL_Texture *background;
+    SDL_Texture *trail;
+    SDL_BlendMode fade_mode;
+    int width, height;
+    bool trail_enabled;     // false if the renderer cannot fade a texture's alpha
+    int steps_since_fade;
+    int pending_fades;
+    TrailSegment pending[LAYER_MAX_PENDING_SEGMENTS];
+    int pending_count;
+} RenderLayers;
+
+// Returns false if the renderer does not support target textures; the caller
+// should then keep drawing everything directly.
+bool render_layers_init(RenderLayers *layers, SDL_Renderer *renderer, int width, int height);
+void render_layers_destroy(RenderLayers *layers);
+
+// Draw calls between these two go into the cached background.
+void render_layers_begin_background(RenderLayers *layers);
+void render_layers_end_background(RenderLayers *layers);
+
+void render_layers_clear_trail(RenderLayers *layers);
+// Adds the segment for one physics step and advances the fade schedule.
+void render_layers_push_segment(RenderLayers *layers, const TrailSegment *segment);
+
+// Flushes queued trail work and copies background and trail to the screen.
+void render_layers_composite(RenderLayers *layers);
+
+#endif
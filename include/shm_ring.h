@@ -0,0 +1,65 @@
+// shm_ring.h - POSIX shared-memory ring for broadcasting random words to
+// local consumers without a socket round-trip or text parsing.
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHM_RING_DEFAULT_NAME "/pendulum_random"
+#define SHM_RING_DEFAULT_CAPACITY 4096
+
+typedef struct ShmRingHeader ShmRingHeader;
+typedef struct ShmRingSlot ShmRingSlot;
+
+// One producer writes, any number of consumers map the same object and read
+// at their own pace. The producer never waits for consumers: a consumer that
+// falls more than `capacity` words behind loses the oldest ones and is told
+// how many.
+typedef struct {
+    int fd;
+    bool owner;             // created by this process, unlinked on close
+    size_t map_size;
+    ShmRingHeader *header;
+    ShmRingSlot *slots;
+    uint64_t mask;
+    char name[64];
+} ShmRing;
+
+typedef struct {
+    const ShmRing *ring;
+    uint64_t next_seq;      // sequence number of the next word to read
+    uint64_t lost;          // words skipped because of overruns
+} ShmRingReader;
+
+// Producer side. capacity is rounded up to a power of two. Fails with
+// errno EEXIST if another live process already produces under name; a ring
+// left behind by a producer that has exited is replaced.
+//
+// The object is created with mode 0660 whatever the umask, owned by the
+// producer's user and effective group. Consumers open it read-write, since
+// shm_ring_wait() registers waiters in the shared header, so they must run
+// as that user or in that group. To share a ring with other users, start
+// the producer with a common group (e.g. `sg pendulum ./main`).
+bool shm_ring_create(ShmRing *ring, const char *name, uint32_t capacity);
+void shm_ring_publish(ShmRing *ring, uint64_t word);
+void shm_ring_publish_batch(ShmRing *ring, const uint64_t *words, size_t count);
+
+// Consumer side.
+bool shm_ring_open(ShmRing *ring, const char *name);
+void shm_ring_reader_init(ShmRingReader *reader, const ShmRing *ring, bool from_oldest);
+
+// Copies up to max consecutive words into out and returns how many. The first
+// one has sequence number *first_seq (if non-NULL). Returns 0 when caught up.
+size_t shm_ring_read(ShmRingReader *reader, uint64_t *out, size_t max, uint64_t *first_seq);
+
+// Blocks until a word past the reader's position is published, or the
+// timeout expires (negative waits forever). Returns true if data is ready.
+bool shm_ring_wait(ShmRingReader *reader, int timeout_ms);
+
+uint64_t shm_ring_head(const ShmRing *ring);
+
+void shm_ring_close(ShmRing *ring);
+
+#endif
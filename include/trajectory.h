@@ -0,0 +1,98 @@
+// trajectory.h - compressed recording of ensemble trajectories, with an
+// index for random access by time.
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "pendulum.h"
+
+#define TRAJECTORY_MAGIC "PTR1"
+#define TRAJECTORY_TRAILER_MAGIC "PTRX"
+#define TRAJECTORY_VERSION 1
+
+// Channel order: theta1, theta2, omega1, omega2.
+#define TRAJECTORY_CHANNELS 4
+
+// Samples are grouped into blocks that decode independently. Within a block
+// each pendulum's channel is one bit stream:
+//  - lossless (quantum 0): XOR of the value with its linear prediction
+//    2*x[i-1] - x[i-2], Gorilla-coded (zero bit, or reuse of the previous
+//    leading/trailing-zero window, or a new window);
+//  - lossy (quantum q > 0): x is rounded to k*q, so |error| <= q/2, and the
+//    delta-of-delta of k is stored in variable-length buckets.
+typedef struct {
+    double quantum[TRAJECTORY_CHANNELS];
+    uint32_t block_samples;
+} TrajectoryOptions;
+
+// File layout (little-endian, as written by the host):
+//   TrajectoryHeader
+//   encoded blocks
+//   TrajectoryIndexEntry index[block_count]
+//   TrajectoryTrailer
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t pendulums;
+    uint32_t block_samples;
+    double t0;
+    double dt;
+    double quantum[TRAJECTORY_CHANNELS];
+} TrajectoryHeader;
+
+typedef struct {
+    uint64_t offset;
+    uint32_t bytes;
+    uint32_t samples;
+} TrajectoryIndexEntry;
+
+typedef struct {
+    uint64_t index_offset;
+    uint64_t block_count;
+    uint64_t sample_count;
+    char magic[4];
+    uint32_t reserved;
+} TrajectoryTrailer;
+
+typedef struct TrajectoryWriter TrajectoryWriter;
+typedef struct TrajectoryReader TrajectoryReader;
+
+// Lossless, 256 samples per block.
+void trajectory_default_options(TrajectoryOptions *opts);
+
+// Output goes through async_io, so encoding overlaps with the disk writes.
+TrajectoryWriter *trajectory_writer_open(const char *path, uint32_t pendulums,
+                                         double t0, double dt, const TrajectoryOptions *opts);
+
+// Appends one sample, the state of every pendulum at the next time step.
+// Fails if a lossy channel gets a value it cannot quantize (NaN, infinity or
+// beyond 2^62 quanta).
+bool trajectory_writer_append(TrajectoryWriter *w, const PendulumState *states);
+
+// Same, from separate arrays as used by the batch integrators.
+bool trajectory_writer_append_soa(TrajectoryWriter *w,
+                                  const double *theta1, const double *theta2,
+                                  const double *omega1, const double *omega2);
+
+uint64_t trajectory_writer_bytes(const TrajectoryWriter *w);
+
+// Encodes the last partial block, writes the index and closes the file.
+bool trajectory_writer_close(TrajectoryWriter *w);
+
+TrajectoryReader *trajectory_reader_open(const char *path);
+void trajectory_reader_close(TrajectoryReader *r);
+
+const TrajectoryHeader *trajectory_reader_header(const TrajectoryReader *r);
+uint64_t trajectory_reader_samples(const TrajectoryReader *r);
+
+// States of all pendulums at sample index. Only the block containing it is
+// read and decoded; the last decoded block is cached.
+bool trajectory_reader_sample(TrajectoryReader *r, uint64_t index, PendulumState *states);
+
+// Sample at or before time t, clamped to the recorded range.
+bool trajectory_reader_at_time(TrajectoryReader *r, double t, PendulumState *states,
+                               uint64_t *index);
+
+#endif // TRAJECTORY_H
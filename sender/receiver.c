@@ -1,13 +1,85 @@
-// receiver.c - UDP receiver for random numbers
+// receiver.c - receiver for published streams over UDP (unicast or a
+// multicast group) and for random numbers from the shared-memory ring
+#include <signal.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <inttypes.h>
 #include <arpa/inet.h>
 
+#include "async_io.h"
+#include "pendulum.h"
+#include "publisher.h"
+#include "shm_ring.h"
+
 #define PORT 12345
+#define RECV_DEPTH 32
+#define MAX_LINE 160
+
+// Lines for stdout are collected in an I/O buffer and written once per batch
+// of received datagrams instead of once per printf.
+typedef struct {
+    AsyncIo *io;
+    int slot;
+    char *buf;
+    size_t capacity;
+    size_t used;
+} LineOutput;
+
+static void output_flush(LineOutput *out) {
+    if (!out->buf) return;
+    async_io_write(out->io, out->slot, out->buf, out->used);
+    out->buf = NULL;
+    out->used = 0;
+}
+
+static void output_line(LineOutput *out, const char *fmt, ...) {
+    if (out->buf && out->used + MAX_LINE > out->capacity) output_flush(out);
+    if (!out->buf) {
+        out->buf = async_io_get_buffer(out->io, &out->capacity);
+        if (!out->buf) return;
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(out->buf + out->used, MAX_LINE, fmt, ap);
+    va_end(ap);
+    if (n > 0) out->used += n < MAX_LINE ? (size_t)n : MAX_LINE - 1;
+}
+
+// Publisher batches are decoded record by record; anything else is printed
+// as text, as sent by older viewers.
+static void print_datagram(const char *data, size_t len, void *ctx) {
+    LineOutput *out = ctx;
+    PublishHeader h;
+    const void *records;
+    if (!publish_decode(data, len, &h, &records)) {
+        if (len > MAX_LINE - 16) len = MAX_LINE - 16;
+        output_line(out, "Received: %.*s\n", (int)len, data);
+        return;
+    }
+    for (uint16_t i = 0; i < h.count; i++) {
+        uint64_t seq = h.sequence + i;
+        if (h.topic == PUBLISH_RANDOM) {
+            uint64_t word;
+            memcpy(&word, (const char *)records + i * sizeof(word), sizeof(word));
+            output_line(out, "Received #%" PRIu64 ": %" PRIu64 "\n", seq, word);
+        } else if (h.topic == PUBLISH_STATE) {
+            PendulumState st;
+            memcpy(&st, (const char *)records + i * sizeof(st), sizeof(st));
+            output_line(out, "State #%" PRIu64 " t=%.2f: theta1=%.6f theta2=%.6f omega1=%.6f omega2=%.6f\n",
+                        seq, h.time, st.theta1, st.theta2, st.omega1, st.omega2);
+        } else {
+            PublishSample sm;
+            memcpy(&sm, (const char *)records + i * sizeof(sm), sizeof(sm));
+            output_line(out, "Sample #%" PRIu64 " t=%.2f: (%.6f, %.6f) (%.6f, %.6f)\n",
+                        seq, h.time, sm.x1, sm.y1, sm.x2, sm.y2);
+        }
+    }
+}
 
-int main() {
+static int receive_udp(int port, const char *group) {
     int sock = socket(AF_INET, SOCK_DGRAM, 0);
     if (sock < 0) {
         perror("socket");
@@ -16,22 +88,127 @@ int main() {
     struct sockaddr_in addr;
     memset(&addr, 0, sizeof(addr));
     addr.sin_family = AF_INET;
-    addr.sin_port = htons(PORT);
+    addr.sin_port = htons((uint16_t)port);
     addr.sin_addr.s_addr = INADDR_ANY;
+    // Several receivers on one host may join the same group.
+    int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
     if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
         perror("bind");
         close(sock);
         return 1;
     }
-    char buf[128];
-    printf("Listening for random numbers on UDP port %d...\n", PORT);
+    if (group) {
+        struct ip_mreq mreq;
+        memset(&mreq, 0, sizeof(mreq));
+        mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (inet_pton(AF_INET, group, &mreq.imr_multiaddr) != 1 ||
+            setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+            perror("join multicast group");
+            close(sock);
+            return 1;
+        }
+    }
+
+    AsyncIoOptions opts;
+    async_io_default_options(&opts);
+    opts.buffer_size = 4096;
+    opts.buffer_count = 2 * RECV_DEPTH;
+    AsyncIo *io = async_io_create(&opts);
+    if (!io) {
+        close(sock);
+        return 1;
+    }
+    int sock_slot = async_io_add_file(io, sock);
+    if (!async_io_recv_start(io, sock_slot, RECV_DEPTH)) {
+        fprintf(stderr, "receive: %s\n", strerror(async_io_error(io)));
+        async_io_destroy(io);
+        close(sock);
+        return 1;
+    }
+    printf("Listening on UDP port %d%s%s (%s)...\n", port, group ? ", group " : "",
+           group ? group : "", async_io_backend(io));
+    // stdout is registered after the last printf so a redirected file
+    // continues at the right offset.
+    fflush(stdout);
+    LineOutput out = { io, async_io_add_file(io, STDOUT_FILENO), NULL, 0, 0 };
+
+    int status = 0;
     while (1) {
-        int len = recv(sock, buf, sizeof(buf)-1, 0);
-        if (len > 0) {
-            buf[len] = 0;
-            printf("Received: %s\n", buf);
+        if (async_io_recv_poll(io, print_datagram, &out, -1) < 0) {
+            fprintf(stderr, "receive: %s\n", strerror(async_io_error(io)));
+            status = 1;
+            break;
         }
+        output_flush(&out);
     }
+    async_io_destroy(io);
     close(sock);
+    return status;
+}
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void request_stop(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+static int receive_shm(const char *name) {
+    ShmRing ring;
+    if (!shm_ring_open(&ring, name)) {
+        return 1;
+    }
+    // No SA_RESTART: the futex wait returns early and the loop sees the flag.
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = request_stop;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    ShmRingReader reader;
+    shm_ring_reader_init(&reader, &ring, false);
+    printf("Reading random numbers from shared-memory ring %s...\n", name);
+
+    uint64_t words[256];
+    uint64_t reported_lost = 0;
+    while (!stop_requested) {
+        if (!shm_ring_wait(&reader, 1000)) continue;
+        uint64_t seq;
+        size_t n;
+        while ((n = shm_ring_read(&reader, words, 256, &seq)) > 0) {
+            for (size_t i = 0; i < n; i++) {
+                printf("Received #%" PRIu64 ": %" PRIu64 "\n", seq + i, words[i]);
+            }
+        }
+        if (reader.lost != reported_lost) {
+            printf("Overrun: %" PRIu64 " numbers lost so far\n", reader.lost);
+            reported_lost = reader.lost;
+        }
+    }
+    shm_ring_close(&ring);
     return 0;
 }
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "--shm") == 0) {
+        return receive_shm(argc > 2 ? argv[2] : SHM_RING_DEFAULT_NAME);
+    }
+    int port = PORT;
+    const char *group = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--group") == 0 && i + 1 < argc) {
+            group = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--port N] [--group ADDR] | --shm [name]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (port <= 0 || port > 65535) {
+        fprintf(stderr, "invalid port\n");
+        return 1;
+    }
+    return receive_udp(port, group);
+}
@@ -99,4 +99,311 @@ void compute(
 
     *new_omega2 = omega2 + (dt / 6.0) *
         (k1_omega2 + 2*k2_omega2 + 2*k3_omega2 + k4_omega2);
-}
\ No newline at end of file
+}
+
+static void accelerations_f(
+    float theta1, float theta2,
+    float omega1, float omega2,
+    float m1, float m2,
+    float L1, float L2,
+    float g,
+    float *theta1_dd, float *theta2_dd
+) {
+    float delta = theta1 - theta2;
+    float den = 2.0f*m1 + m2 - m2 * cosf(2.0f * delta);
+
+    *theta1_dd =
+        (-g * (2.0f*m1 + m2) * sinf(theta1)
+        - m2 * g * sinf(theta1 - 2.0f * theta2)
+        - 2.0f * sinf(delta) * m2 *
+          (omega2*omega2*L2 + omega1*omega1*L1*cosf(delta)))
+        / (L1 * den);
+
+    *theta2_dd =
+        (2.0f * sinf(delta) *
+         (omega1*omega1*L1*(m1 + m2)
+        + g*(m1 + m2)*cosf(theta1)
+        + omega2*omega2*L2*m2*cosf(delta)))
+        / (L2 * den);
+}
+
+
+void compute_f(
+    float theta1, float theta2,
+    float omega1, float omega2,
+    float m1, float m2,
+    float L1, float L2,
+    float g, float dt,
+    float *new_theta1, float *new_theta2,
+    float *new_omega1, float *new_omega2
+) {
+    float h = 0.5f * dt;
+
+    float k1_omega1, k1_omega2;
+    accelerations_f(theta1, theta2, omega1, omega2,
+                    m1, m2, L1, L2, g,
+                    &k1_omega1, &k1_omega2);
+    float k1_theta1 = omega1;
+    float k1_theta2 = omega2;
+
+    float k2_omega1, k2_omega2;
+    float k2_theta1 = omega1 + h * k1_omega1;
+    float k2_theta2 = omega2 + h * k1_omega2;
+    accelerations_f(theta1 + h * k1_theta1, theta2 + h * k1_theta2,
+                    k2_theta1, k2_theta2,
+                    m1, m2, L1, L2, g,
+                    &k2_omega1, &k2_omega2);
+
+    float k3_omega1, k3_omega2;
+    float k3_theta1 = omega1 + h * k2_omega1;
+    float k3_theta2 = omega2 + h * k2_omega2;
+    accelerations_f(theta1 + h * k2_theta1, theta2 + h * k2_theta2,
+                    k3_theta1, k3_theta2,
+                    m1, m2, L1, L2, g,
+                    &k3_omega1, &k3_omega2);
+
+    float k4_omega1, k4_omega2;
+    float k4_theta1 = omega1 + dt * k3_omega1;
+    float k4_theta2 = omega2 + dt * k3_omega2;
+    accelerations_f(theta1 + dt * k3_theta1, theta2 + dt * k3_theta2,
+                    k4_theta1, k4_theta2,
+                    m1, m2, L1, L2, g,
+                    &k4_omega1, &k4_omega2);
+
+    float w = dt / 6.0f;
+    *new_theta1 = theta1 + w * (k1_theta1 + 2.0f*k2_theta1 + 2.0f*k3_theta1 + k4_theta1);
+    *new_theta2 = theta2 + w * (k1_theta2 + 2.0f*k2_theta2 + 2.0f*k3_theta2 + k4_theta2);
+    *new_omega1 = omega1 + w * (k1_omega1 + 2.0f*k2_omega1 + 2.0f*k3_omega1 + k4_omega1);
+    *new_omega2 = omega2 + w * (k1_omega2 + 2.0f*k2_omega2 + 2.0f*k3_omega2 + k4_omega2);
+}
+
+
+// Mixed precision: the state and the RK4 combination stay in double so
+// round-off does not accumulate step over step, only the stage
+// accelerations are evaluated in float.
+void compute_mixed(
+    double theta1, double theta2,
+    double omega1, double omega2,
+    double m1, double m2,
+    double L1, double L2,
+    double g, double dt,
+    double *new_theta1, double *new_theta2,
+    double *new_omega1, double *new_omega2
+) {
+    float fm1 = (float)m1, fm2 = (float)m2;
+    float fL1 = (float)L1, fL2 = (float)L2, fg = (float)g;
+    double h = 0.5 * dt;
+    float a1, a2;
+
+    accelerations_f((float)theta1, (float)theta2, (float)omega1, (float)omega2,
+                    fm1, fm2, fL1, fL2, fg, &a1, &a2);
+    double k1_omega1 = a1, k1_omega2 = a2;
+    double k1_theta1 = omega1;
+    double k1_theta2 = omega2;
+
+    double k2_theta1 = omega1 + h * k1_omega1;
+    double k2_theta2 = omega2 + h * k1_omega2;
+    accelerations_f((float)(theta1 + h * k1_theta1), (float)(theta2 + h * k1_theta2),
+                    (float)k2_theta1, (float)k2_theta2,
+                    fm1, fm2, fL1, fL2, fg, &a1, &a2);
+    double k2_omega1 = a1, k2_omega2 = a2;
+
+    double k3_theta1 = omega1 + h * k2_omega1;
+    double k3_theta2 = omega2 + h * k2_omega2;
+    accelerations_f((float)(theta1 + h * k2_theta1), (float)(theta2 + h * k2_theta2),
+                    (float)k3_theta1, (float)k3_theta2,
+                    fm1, fm2, fL1, fL2, fg, &a1, &a2);
+    double k3_omega1 = a1, k3_omega2 = a2;
+
+    double k4_theta1 = omega1 + dt * k3_omega1;
+    double k4_theta2 = omega2 + dt * k3_omega2;
+    accelerations_f((float)(theta1 + dt * k3_theta1), (float)(theta2 + dt * k3_theta2),
+                    (float)k4_theta1, (float)k4_theta2,
+                    fm1, fm2, fL1, fL2, fg, &a1, &a2);
+    double k4_omega1 = a1, k4_omega2 = a2;
+
+    double w = dt / 6.0;
+    *new_theta1 = theta1 + w * (k1_theta1 + 2*k2_theta1 + 2*k3_theta1 + k4_theta1);
+    *new_theta2 = theta2 + w * (k1_theta2 + 2*k2_theta2 + 2*k3_theta2 + k4_theta2);
+    *new_omega1 = omega1 + w * (k1_omega1 + 2*k2_omega1 + 2*k3_omega1 + k4_omega1);
+    *new_omega2 = omega2 + w * (k1_omega2 + 2*k2_omega2 + 2*k3_omega2 + k4_omega2);
+}
+
+
+void compute_batch(
+    double *theta1, double *theta2,
+    double *omega1, double *omega2,
+    size_t n,
+    double m1, double m2,
+    double L1, double L2,
+    double g, double dt
+) {
+    for (size_t i = 0; i < n; i++) {
+        compute(theta1[i], theta2[i], omega1[i], omega2[i],
+                m1, m2, L1, L2, g, dt,
+                &theta1[i], &theta2[i], &omega1[i], &omega2[i]);
+    }
+}
+
+
+void compute_batch_f(
+    float *theta1, float *theta2,
+    float *omega1, float *omega2,
+    size_t n,
+    float m1, float m2,
+    float L1, float L2,
+    float g, float dt
+) {
+    for (size_t i = 0; i < n; i++) {
+        compute_f(theta1[i], theta2[i], omega1[i], omega2[i],
+                  m1, m2, L1, L2, g, dt,
+                  &theta1[i], &theta2[i], &omega1[i], &omega2[i]);
+    }
+}
+
+
+void compute_batch_mixed(
+    double *theta1, double *theta2,
+    double *omega1, double *omega2,
+    size_t n,
+    double m1, double m2,
+    double L1, double L2,
+    double g, double dt
+) {
+    for (size_t i = 0; i < n; i++) {
+        compute_mixed(theta1[i], theta2[i], omega1[i], omega2[i],
+                      m1, m2, L1, L2, g, dt,
+                      &theta1[i], &theta2[i], &omega1[i], &omega2[i]);
+    }
+}
+
+
+void prepare_config(PreparedConfig *cfg,
+                    double m1, double m2,
+                    double L1, double L2,
+                    double g) {
+    cfg->m1 = m1;
+    cfg->m2 = m2;
+    cfg->l1 = L1;
+    cfg->l2 = L2;
+    cfg->g = g;
+    cfg->g_2m1_m2 = g * (2*m1 + m2);
+    cfg->g_m2 = g * m2;
+    cfg->two_m2 = 2 * m2;
+    cfg->l1_m1_m2 = L1 * (m1 + m2);
+    cfg->g_m1_m2 = g * (m1 + m2);
+    cfg->l2_m2 = L2 * m2;
+    cfg->inv_l1 = 1.0 / L1;
+    cfg->inv_l2 = 1.0 / L2;
+    cfg->g_over_l = g / L1;
+    cfg->symmetric = (m1 == m2 && L1 == L2);
+}
+
+
+// Same equations as accelerations(), rewritten around one sin/cos pair per
+// angle. delta, 2*delta and theta1 - 2*theta2 come from the angle-difference
+// and double-angle identities, and the denominator
+//     2*m1 + m2 - m2*cos(2*delta) = 2*(m1 + m2*sin^2(delta))
+// no longer cancels when delta is small.
+static inline void prepared_accelerations(
+    const PreparedConfig *cfg,
+    double theta1, double theta2,
+    double omega1, double omega2,
+    double *theta1_dd, double *theta2_dd
+) {
+    double s1 = sin(theta1), c1 = cos(theta1);
+    double s2 = sin(theta2), c2 = cos(theta2);
+    double sd = s1*c2 - c1*s2;
+    double cd = c1*c2 + s1*s2;
+    double s1_2 = sd*c2 - cd*s2;            // sin(theta1 - 2*theta2)
+    double w1_sq = omega1*omega1;
+    double w2_sq = omega2*omega2;
+
+    if (cfg->symmetric) {
+        // m1 == m2 and L1 == L2: the masses cancel and only g/L remains.
+        double inv_den = 1.0 / (1.0 + sd*sd);
+        *theta1_dd = (-cfg->g_over_l * (3*s1 + s1_2)
+                      - 2*sd * (w2_sq + w1_sq*cd)) * 0.5 * inv_den;
+        *theta2_dd = sd * (2*w1_sq + 2*cfg->g_over_l*c1 + w2_sq*cd) * inv_den;
+        return;
+    }
+
+    double inv_den = 0.5 / (cfg->m1 + cfg->m2*sd*sd);
+    *theta1_dd =
+        (-cfg->g_2m1_m2 * s1
+        - cfg->g_m2 * s1_2
+        - cfg->two_m2 * sd * (w2_sq*cfg->l2 + w1_sq*cfg->l1*cd))
+        * cfg->inv_l1 * inv_den;
+    *theta2_dd =
+        (2*sd * (w1_sq*cfg->l1_m1_m2 + cfg->g_m1_m2*c1 + w2_sq*cfg->l2_m2*cd))
+        * cfg->inv_l2 * inv_den;
+}
+
+
+void accelerations_prepared(
+    const PreparedConfig *cfg,
+    double theta1, double theta2,
+    double omega1, double omega2,
+    double *theta1_dd, double *theta2_dd
+) {
+    prepared_accelerations(cfg, theta1, theta2, omega1, omega2, theta1_dd, theta2_dd);
+}
+
+
+void compute_prepared(
+    const PreparedConfig *cfg,
+    double theta1, double theta2,
+    double omega1, double omega2,
+    double dt,
+    double *new_theta1, double *new_theta2,
+    double *new_omega1, double *new_omega2
+) {
+    double h = 0.5 * dt;
+
+    double k1_omega1, k1_omega2;
+    prepared_accelerations(cfg, theta1, theta2, omega1, omega2,
+                           &k1_omega1, &k1_omega2);
+    double k1_theta1 = omega1;
+    double k1_theta2 = omega2;
+
+    double k2_omega1, k2_omega2;
+    double k2_theta1 = omega1 + h * k1_omega1;
+    double k2_theta2 = omega2 + h * k1_omega2;
+    prepared_accelerations(cfg, theta1 + h * k1_theta1, theta2 + h * k1_theta2,
+                           k2_theta1, k2_theta2,
+                           &k2_omega1, &k2_omega2);
+
+    double k3_omega1, k3_omega2;
+    double k3_theta1 = omega1 + h * k2_omega1;
+    double k3_theta2 = omega2 + h * k2_omega2;
+    prepared_accelerations(cfg, theta1 + h * k2_theta1, theta2 + h * k2_theta2,
+                           k3_theta1, k3_theta2,
+                           &k3_omega1, &k3_omega2);
+
+    double k4_omega1, k4_omega2;
+    double k4_theta1 = omega1 + dt * k3_omega1;
+    double k4_theta2 = omega2 + dt * k3_omega2;
+    prepared_accelerations(cfg, theta1 + dt * k3_theta1, theta2 + dt * k3_theta2,
+                           k4_theta1, k4_theta2,
+                           &k4_omega1, &k4_omega2);
+
+    double w = dt / 6.0;
+    *new_theta1 = theta1 + w * (k1_theta1 + 2*k2_theta1 + 2*k3_theta1 + k4_theta1);
+    *new_theta2 = theta2 + w * (k1_theta2 + 2*k2_theta2 + 2*k3_theta2 + k4_theta2);
+    *new_omega1 = omega1 + w * (k1_omega1 + 2*k2_omega1 + 2*k3_omega1 + k4_omega1);
+    *new_omega2 = omega2 + w * (k1_omega2 + 2*k2_omega2 + 2*k3_omega2 + k4_omega2);
+}
+
+
+void compute_batch_prepared(
+    const PreparedConfig *cfg,
+    double *theta1, double *theta2,
+    double *omega1, double *omega2,
+    size_t n,
+    double dt
+) {
+    for (size_t i = 0; i < n; i++) {
+        compute_prepared(cfg, theta1[i], theta2[i], omega1[i], omega2[i], dt,
+                         &theta1[i], &theta2[i], &omega1[i], &omega2[i]);
+    }
+}
@@ -0,0 +1,679 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "async_io.h"
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+// liburing is not a dependency: the three io_uring system calls and the ring
+// protocol are small enough to drive directly.
+
+typedef enum {
+    BUF_FREE,
+    BUF_CALLER,     // handed out by async_io_get_buffer()
+    BUF_PENDING,    // waiting for an earlier write to the same stream
+    BUF_WRITING,
+    BUF_READING,
+    BUF_READY       // datagram received, not yet delivered
+} BufState;
+
+typedef struct {
+    BufState state;
+    int slot;
+    size_t len;         // bytes to write, or bytes received
+    off_t offset;       // file offset of a write to a regular file
+    int next;           // pending-write or ready-read list link, -1 ends
+} IoBuffer;
+
+typedef struct {
+    int fd;
+    bool fixed;         // registered in the ring's file table
+    bool stream;        // no offsets: writes are issued one at a time
+    bool busy;
+    off_t offset;       // next write offset for regular files
+    int pending_head;
+    int pending_tail;
+} IoFile;
+
+struct AsyncIo {
+    AsyncIoOptions opts;
+    bool uring;
+    bool fixed_buffers;
+    bool timed_wait;        // io_uring_enter() accepts a timeout (5.11+)
+    int error;
+
+    int ring_fd;
+    void *ring_map;
+    size_t ring_map_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    _Atomic uint32_t *sq_head;
+    _Atomic uint32_t *sq_tail;
+    _Atomic uint32_t *cq_head;
+    _Atomic uint32_t *cq_tail;
+    uint32_t *sq_array;
+    uint32_t sq_mask;
+    uint32_t sq_entries;
+    uint32_t cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned queued;        // SQEs not yet passed to the kernel
+    unsigned inflight;      // requests the kernel has not completed
+
+    char *pool;
+    IoBuffer *bufs;
+    int *free_stack;
+    unsigned free_count;
+    unsigned writes_outstanding;
+
+    IoFile files[ASYNC_IO_MAX_FILES];
+    int file_count;
+
+    int recv_slot;
+    unsigned recv_depth;
+    bool recv_failed;
+    bool closing;
+    int ready_head;
+    int ready_tail;
+};
+
+static void set_error(AsyncIo *io, int err) {
+    if (!io->error) io->error = err;
+}
+
+static char *buffer_data(const AsyncIo *io, int b) {
+    return io->pool + (size_t)b * io->opts.buffer_size;
+}
+
+static int take_buffer(AsyncIo *io) {
+    if (io->free_count == 0) return -1;
+    return io->free_stack[--io->free_count];
+}
+
+static void release_buffer(AsyncIo *io, int b) {
+    io->bufs[b].state = BUF_FREE;
+    io->free_stack[io->free_count++] = b;
+}
+
+// Blocking write of data; offset < 0 writes at the current position.
+static bool write_all(AsyncIo *io, int fd, const char *data, size_t len, off_t offset) {
+    while (len > 0) {
+        ssize_t n = offset < 0 ? write(fd, data, len) : pwrite(fd, data, len, offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            set_error(io, errno);
+            return false;
+        }
+        data += n;
+        len -= (size_t)n;
+        if (offset >= 0) offset += n;
+    }
+    return true;
+}
+
+static void complete(AsyncIo *io, int b, int res);
+
+#ifdef __linux__
+
+// user_data of cancel requests; buffer indices are small.
+#define CANCEL_TAG UINT64_MAX
+// Longest wait for outstanding requests when the ring is torn down.
+#define ASYNC_IO_TEARDOWN_MS 1000
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned submit, unsigned min_complete, unsigned flags,
+                              void *arg, size_t arg_size) {
+    return (int)syscall(__NR_io_uring_enter, fd, submit, min_complete, flags, arg, arg_size);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned count) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+static bool setup_uring(AsyncIo *io) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    unsigned entries = io->opts.queue_depth > io->opts.buffer_count ?
+                       io->opts.queue_depth : io->opts.buffer_count;
+    int fd = sys_io_uring_setup(entries, &p);
+    if (fd < 0) return false;
+    // Kernels before 5.4 need separate SQ and CQ mappings; not worth supporting.
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+        close(fd);
+        return false;
+    }
+
+    size_t sq_size = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+    size_t cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    size_t map_size = sq_size > cq_size ? sq_size : cq_size;
+    char *map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     fd, IORING_OFF_SQ_RING);
+    if (map == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    size_t sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    void *sqes = mmap(NULL, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        munmap(map, map_size);
+        close(fd);
+        return false;
+    }
+
+    io->ring_fd = fd;
+    io->ring_map = map;
+    io->ring_map_size = map_size;
+    io->sqes = sqes;
+    io->sqes_size = sqes_size;
+    io->sq_head = (_Atomic uint32_t *)(map + p.sq_off.head);
+    io->sq_tail = (_Atomic uint32_t *)(map + p.sq_off.tail);
+    io->sq_array = (uint32_t *)(map + p.sq_off.array);
+    io->sq_mask = *(uint32_t *)(map + p.sq_off.ring_mask);
+    io->sq_entries = p.sq_entries;
+    io->cq_head = (_Atomic uint32_t *)(map + p.cq_off.head);
+    io->cq_tail = (_Atomic uint32_t *)(map + p.cq_off.tail);
+    io->cq_mask = *(uint32_t *)(map + p.cq_off.ring_mask);
+    io->cqes = (struct io_uring_cqe *)(map + p.cq_off.cqes);
+    io->timed_wait = (p.features & IORING_FEAT_EXT_ARG) != 0;
+
+    // Registered buffers skip the per-request page pinning. Without them
+    // (e.g. a low RLIMIT_MEMLOCK on older kernels) plain READ/WRITE still work.
+    struct iovec iov[io->opts.buffer_count];
+    for (unsigned i = 0; i < io->opts.buffer_count; i++) {
+        iov[i].iov_base = buffer_data(io, (int)i);
+        iov[i].iov_len = io->opts.buffer_size;
+    }
+    io->fixed_buffers = sys_io_uring_register(fd, IORING_REGISTER_BUFFERS, iov,
+                                              io->opts.buffer_count) == 0;
+
+    // Sparse fixed-file table, filled in by async_io_add_file().
+    int fds[ASYNC_IO_MAX_FILES];
+    for (int i = 0; i < ASYNC_IO_MAX_FILES; i++) fds[i] = -1;
+    sys_io_uring_register(fd, IORING_REGISTER_FILES, fds, ASYNC_IO_MAX_FILES);
+    return true;
+}
+
+static bool register_file(AsyncIo *io, int slot) {
+    struct io_uring_files_update update;
+    memset(&update, 0, sizeof(update));
+    update.offset = (uint32_t)slot;
+    update.fds = (uint64_t)(uintptr_t)&io->files[slot].fd;
+    return sys_io_uring_register(io->ring_fd, IORING_REGISTER_FILES_UPDATE, &update, 1) == 1;
+}
+
+// Flushes queued SQEs to the kernel, optionally waiting for wait_nr completions.
+static bool submit(AsyncIo *io, unsigned wait_nr) {
+    for (;;) {
+        unsigned flags = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+        int ret = sys_io_uring_enter(io->ring_fd, io->queued, wait_nr, flags, NULL, 0);
+        if (ret >= 0) {
+            io->queued -= (unsigned)ret;
+            return true;
+        }
+        if (errno == EINTR) continue;
+        // EAGAIN/EBUSY: the completion queue has to be drained first.
+        if (errno != EAGAIN && errno != EBUSY) set_error(io, errno);
+        return false;
+    }
+}
+
+static unsigned reap(AsyncIo *io);
+
+// Returns NULL only after a hard submission error, recorded in io->error.
+static struct io_uring_sqe *get_sqe(AsyncIo *io) {
+    uint32_t tail, head;
+    for (;;) {
+        // Re-read every time: reaping below can complete requests that queue
+        // new SQEs through this function.
+        tail = atomic_load_explicit(io->sq_tail, memory_order_relaxed);
+        head = atomic_load_explicit(io->sq_head, memory_order_acquire);
+        if (tail - head < io->sq_entries) break;
+        // Normally the kernel consumes the whole queue during io_uring_enter().
+        // On EAGAIN/EBUSY it took nothing, and the pending SQEs must not be
+        // overwritten: drain completions (or wait for one) and try again.
+        if (submit(io, 0)) {
+            head = atomic_load_explicit(io->sq_head, memory_order_acquire);
+            if (tail - head < io->sq_entries) continue;
+        } else if (io->error) {
+            return NULL;
+        }
+        if (reap(io) == 0) {
+            struct pollfd pfd = { io->ring_fd, POLLIN, 0 };
+            poll(&pfd, 1, 1);
+        }
+    }
+    uint32_t index = tail & io->sq_mask;
+    struct io_uring_sqe *sqe = &io->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    io->sq_array[index] = index;
+    return sqe;
+}
+
+static void commit_sqe(AsyncIo *io) {
+    uint32_t tail = atomic_load_explicit(io->sq_tail, memory_order_relaxed);
+    atomic_store_explicit(io->sq_tail, tail + 1, memory_order_release);
+    io->queued++;
+    io->inflight++;
+    if (io->queued >= io->opts.submit_batch) submit(io, 0);
+}
+
+static void prep_rw(AsyncIo *io, struct io_uring_sqe *sqe, int slot, int b,
+                    uint8_t fixed_op, uint8_t plain_op, size_t len, uint64_t offset) {
+    const IoFile *f = &io->files[slot];
+    sqe->opcode = io->fixed_buffers ? fixed_op : plain_op;
+    if (f->fixed) {
+        sqe->fd = slot;
+        sqe->flags = IOSQE_FIXED_FILE;
+    } else {
+        sqe->fd = f->fd;
+    }
+    sqe->addr = (uint64_t)(uintptr_t)buffer_data(io, b);
+    sqe->len = (uint32_t)len;
+    sqe->off = offset;
+    if (io->fixed_buffers) sqe->buf_index = (uint16_t)b;
+    sqe->user_data = (uint64_t)b;
+}
+
+// Streams and O_APPEND files are written at offset -1, the current file
+// position, rather than relying on the kernel ignoring the offset.
+static void issue_write(AsyncIo *io, int b) {
+    IoBuffer *buf = &io->bufs[b];
+    IoFile *f = &io->files[buf->slot];
+    buf->offset = f->offset;
+    if (f->stream) {
+        f->busy = true;
+    } else {
+        f->offset += (off_t)buf->len;
+    }
+    buf->state = BUF_WRITING;
+    struct io_uring_sqe *sqe = get_sqe(io);
+    if (!sqe) {
+        complete(io, b, -io->error);
+        return;
+    }
+    prep_rw(io, sqe, buf->slot, b, IORING_OP_WRITE_FIXED, IORING_OP_WRITE,
+            buf->len, f->stream ? (uint64_t)-1 : (uint64_t)buf->offset);
+    commit_sqe(io);
+}
+
+static void arm_read(AsyncIo *io, int b) {
+    io->bufs[b].state = BUF_READING;
+    io->bufs[b].slot = io->recv_slot;
+    struct io_uring_sqe *sqe = get_sqe(io);
+    if (!sqe) {
+        complete(io, b, -io->error);
+        return;
+    }
+    prep_rw(io, sqe, io->recv_slot, b, IORING_OP_READ_FIXED, IORING_OP_READ,
+            io->opts.buffer_size, 0);
+    commit_sqe(io);
+}
+
+static unsigned reap(AsyncIo *io) {
+    unsigned n = 0;
+    uint32_t head = atomic_load_explicit(io->cq_head, memory_order_relaxed);
+    while (head != atomic_load_explicit(io->cq_tail, memory_order_acquire)) {
+        const struct io_uring_cqe *cqe = &io->cqes[head & io->cq_mask];
+        uint64_t data = cqe->user_data;
+        int res = cqe->res;
+        atomic_store_explicit(io->cq_head, ++head, memory_order_release);
+        io->inflight--;
+        if (data != CANCEL_TAG) complete(io, (int)data, res);
+        n++;
+    }
+    return n;
+}
+
+// Reaps at least one completion, waiting up to timeout_ms (negative: forever).
+static bool wait_completion(AsyncIo *io, int timeout_ms) {
+    if (reap(io)) return true;
+    if (io->inflight == 0) return false;
+    if (timeout_ms < 0) {
+        submit(io, 1);
+        return reap(io) > 0;
+    }
+    if (io->timed_wait) {
+        struct __kernel_timespec ts = { timeout_ms / 1000, (timeout_ms % 1000) * 1000000L };
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        int ret = sys_io_uring_enter(io->ring_fd, io->queued, 1,
+                                     IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                                     &arg, sizeof(arg));
+        if (ret > 0) io->queued -= (unsigned)ret;
+        return reap(io) > 0;
+    }
+    submit(io, 0);
+    if (reap(io)) return true;
+    struct pollfd pfd = { io->ring_fd, POLLIN, 0 };
+    if (poll(&pfd, 1, timeout_ms) <= 0) return false;
+    return reap(io) > 0;
+}
+
+static int64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// The kernel may still write into posted read buffers until their
+// cancellation completes, so wait for that before unmapping and freeing.
+// A read whose cancel could not be queued may never complete, so the wait is
+// bounded. Returns false if requests are still outstanding: closing the ring
+// makes the kernel cancel them, but only asynchronously, so the caller must
+// not free the buffer pool.
+static bool teardown_uring(AsyncIo *io) {
+    io->closing = true;
+    for (unsigned b = 0; b < io->opts.buffer_count; b++) {
+        if (io->bufs[b].state != BUF_READING) continue;
+        struct io_uring_sqe *sqe = get_sqe(io);
+        if (!sqe) break;
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = b;
+        sqe->user_data = CANCEL_TAG;
+        commit_sqe(io);
+    }
+    int64_t deadline = now_ms() + ASYNC_IO_TEARDOWN_MS;
+    for (int64_t left; io->inflight > 0 && (left = deadline - now_ms()) > 0;) {
+        wait_completion(io, (int)left);
+    }
+    bool quiesced = io->inflight == 0;
+    munmap(io->sqes, io->sqes_size);
+    munmap(io->ring_map, io->ring_map_size);
+    close(io->ring_fd);
+    return quiesced;
+}
+
+#else
+
+// No io_uring outside Linux: every AsyncIo takes the blocking path.
+static bool setup_uring(AsyncIo *io) { (void)io; return false; }
+static bool register_file(AsyncIo *io, int slot) { (void)io; (void)slot; return false; }
+static bool submit(AsyncIo *io, unsigned wait_nr) { (void)io; (void)wait_nr; return false; }
+static void issue_write(AsyncIo *io, int b) { (void)io; (void)b; }
+static void arm_read(AsyncIo *io, int b) { (void)io; (void)b; }
+static unsigned reap(AsyncIo *io) { (void)io; return 0; }
+static bool wait_completion(AsyncIo *io, int timeout_ms) { (void)io; (void)timeout_ms; return false; }
+static bool teardown_uring(AsyncIo *io) { (void)io; return true; }
+
+#endif // __linux__
+
+static void complete(AsyncIo *io, int b, int res) {
+    IoBuffer *buf = &io->bufs[b];
+    if (buf->state == BUF_READING) {
+        if (res >= 0) {
+            buf->state = BUF_READY;
+            buf->len = (size_t)res;
+            buf->next = -1;
+            if (io->ready_tail >= 0) io->bufs[io->ready_tail].next = b;
+            else io->ready_head = b;
+            io->ready_tail = b;
+        } else if (io->closing) {
+            release_buffer(io, b);
+        } else if (res == -EAGAIN || res == -EINTR) {
+            arm_read(io, b);
+        } else {
+            set_error(io, -res);
+            io->recv_failed = true;
+            release_buffer(io, b);
+        }
+        return;
+    }
+
+    IoFile *f = &io->files[buf->slot];
+    if (res < 0) {
+        set_error(io, -res);
+    } else if ((size_t)res < buf->len) {
+        // Short write: finish synchronously, it is rare and keeps ordering simple.
+        write_all(io, f->fd, buffer_data(io, b) + res, buf->len - (size_t)res,
+                  f->stream ? -1 : buf->offset + res);
+    }
+    release_buffer(io, b);
+    io->writes_outstanding--;
+    if (f->stream) {
+        f->busy = false;
+        int next = f->pending_head;
+        if (next >= 0) {
+            f->pending_head = io->bufs[next].next;
+            if (f->pending_head < 0) f->pending_tail = -1;
+            issue_write(io, next);
+        }
+    }
+}
+
+void async_io_default_options(AsyncIoOptions *opts) {
+    opts->queue_depth = 64;
+    opts->buffer_count = 16;
+    opts->buffer_size = 64 * 1024;
+    opts->submit_batch = 8;
+    opts->force_blocking = false;
+}
+
+AsyncIo *async_io_create(const AsyncIoOptions *opts) {
+    AsyncIo *io = calloc(1, sizeof(*io));
+    if (!io) return NULL;
+    io->opts = *opts;
+    if (io->opts.buffer_count < 2) io->opts.buffer_count = 2;
+    if (io->opts.buffer_size < 512) io->opts.buffer_size = 512;
+    if (io->opts.submit_batch < 1) io->opts.submit_batch = 1;
+    // Buffers are registered page by page.
+    io->opts.buffer_size = (io->opts.buffer_size + 4095) & ~(size_t)4095;
+    io->ring_fd = -1;
+    io->recv_slot = -1;
+    io->ready_head = io->ready_tail = -1;
+
+    size_t count = io->opts.buffer_count;
+    io->pool = aligned_alloc(4096, count * io->opts.buffer_size);
+    io->bufs = calloc(count, sizeof(IoBuffer));
+    io->free_stack = calloc(count, sizeof(int));
+    if (!io->pool || !io->bufs || !io->free_stack) {
+        free(io->pool);
+        free(io->bufs);
+        free(io->free_stack);
+        free(io);
+        return NULL;
+    }
+    for (size_t i = count; i-- > 0;) release_buffer(io, (int)i);
+
+    const char *mode = getenv("PENDULUM_IO");
+    bool blocking = io->opts.force_blocking || (mode && strcmp(mode, "blocking") == 0);
+    io->uring = !blocking && setup_uring(io);
+    return io;
+}
+
+bool async_io_uses_uring(const AsyncIo *io) {
+    return io->uring;
+}
+
+const char *async_io_backend(const AsyncIo *io) {
+    return io->uring ? "io_uring" : "blocking";
+}
+
+int async_io_error(const AsyncIo *io) {
+    return io->error;
+}
+
+int async_io_add_file(AsyncIo *io, int fd) {
+    if (fd < 0 || io->file_count >= ASYNC_IO_MAX_FILES) return -1;
+    int slot = io->file_count++;
+    IoFile *f = &io->files[slot];
+    memset(f, 0, sizeof(*f));
+    f->fd = fd;
+    f->pending_head = f->pending_tail = -1;
+
+    off_t pos = lseek(fd, 0, SEEK_CUR);
+    int flags = fcntl(fd, F_GETFL);
+    f->stream = pos < 0 || (flags >= 0 && (flags & O_APPEND));
+    f->offset = pos < 0 ? 0 : pos;
+
+    if (io->uring) f->fixed = register_file(io, slot);
+    return slot;
+}
+
+char *async_io_get_buffer(AsyncIo *io, size_t *capacity) {
+    while (io->free_count == 0) {
+        if (!io->uring || !wait_completion(io, -1)) return NULL;
+    }
+    int b = take_buffer(io);
+    io->bufs[b].state = BUF_CALLER;
+    if (capacity) *capacity = io->opts.buffer_size;
+    return buffer_data(io, b);
+}
+
+bool async_io_write(AsyncIo *io, int slot, char *buf, size_t len) {
+    ptrdiff_t index = (buf - io->pool) / (ptrdiff_t)io->opts.buffer_size;
+    if (slot < 0 || slot >= io->file_count || index < 0 ||
+        index >= (ptrdiff_t)io->opts.buffer_count || len > io->opts.buffer_size ||
+        io->bufs[index].state != BUF_CALLER) {
+        return false;
+    }
+    int b = (int)index;
+    IoFile *f = &io->files[slot];
+    if (len == 0) {
+        release_buffer(io, b);
+        return true;
+    }
+    if (!io->uring) {
+        bool ok = write_all(io, f->fd, buf, len, f->stream ? -1 : f->offset);
+        if (ok && !f->stream) f->offset += (off_t)len;
+        release_buffer(io, b);
+        return ok;
+    }
+
+    IoBuffer *ib = &io->bufs[b];
+    ib->slot = slot;
+    ib->len = len;
+    io->writes_outstanding++;
+    if (f->stream && f->busy) {
+        ib->state = BUF_PENDING;
+        ib->next = -1;
+        if (f->pending_tail >= 0) io->bufs[f->pending_tail].next = b;
+        else f->pending_head = b;
+        f->pending_tail = b;
+        return true;
+    }
+    issue_write(io, b);
+    return io->error == 0;
+}
+
+bool async_io_write_copy(AsyncIo *io, int slot, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        size_t capacity;
+        char *buf = async_io_get_buffer(io, &capacity);
+        if (!buf) return false;
+        size_t n = len < capacity ? len : capacity;
+        memcpy(buf, p, n);
+        if (!async_io_write(io, slot, buf, n)) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool async_io_flush(AsyncIo *io) {
+    if (io->uring) {
+        submit(io, 0);
+        while (io->writes_outstanding > 0) {
+            if (!wait_completion(io, -1)) break;
+        }
+    }
+    for (int i = 0; i < io->file_count; i++) {
+        if (!io->files[i].stream) lseek(io->files[i].fd, io->files[i].offset, SEEK_SET);
+    }
+    return io->error == 0;
+}
+
+bool async_io_recv_start(AsyncIo *io, int slot, unsigned depth) {
+    if (slot < 0 || slot >= io->file_count || io->recv_slot >= 0) return false;
+    // Half the buffers stay available for output.
+    unsigned limit = io->opts.buffer_count / 2;
+    io->recv_slot = slot;
+    io->recv_depth = depth < 1 ? 1 : depth > limit ? limit : depth;
+    if (!io->uring) return true;
+    for (unsigned i = 0; i < io->recv_depth; i++) {
+        arm_read(io, take_buffer(io));
+    }
+    submit(io, 0);
+    return io->error == 0;
+}
+
+static int recv_poll_blocking(AsyncIo *io, AsyncIoRecvFn fn, void *ctx, int timeout_ms) {
+    int fd = io->files[io->recv_slot].fd;
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    int ready = poll(&pfd, 1, timeout_ms);
+    if (ready <= 0) return ready < 0 && errno != EINTR ? -1 : 0;
+
+    int b = take_buffer(io);
+    if (b < 0) return -1;
+    char *data = buffer_data(io, b);
+    int delivered = 0;
+    while ((unsigned)delivered < io->recv_depth) {
+        ssize_t n = recv(fd, data, io->opts.buffer_size, MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                set_error(io, errno);
+                if (delivered == 0) delivered = -1;
+            }
+            break;
+        }
+        fn(data, (size_t)n, ctx);
+        delivered++;
+    }
+    release_buffer(io, b);
+    return delivered;
+}
+
+int async_io_recv_poll(AsyncIo *io, AsyncIoRecvFn fn, void *ctx, int timeout_ms) {
+    if (io->recv_slot < 0) return -1;
+    if (!io->uring) return recv_poll_blocking(io, fn, ctx, timeout_ms);
+
+    if (io->ready_head < 0 && !wait_completion(io, timeout_ms)) {
+        return io->recv_failed ? -1 : 0;
+    }
+    reap(io);
+    int delivered = 0;
+    while (io->ready_head >= 0) {
+        int b = io->ready_head;
+        io->ready_head = io->bufs[b].next;
+        if (io->ready_head < 0) io->ready_tail = -1;
+        fn(buffer_data(io, b), io->bufs[b].len, ctx);
+        delivered++;
+        arm_read(io, b);
+    }
+    // All re-armed reads go to the kernel in one call.
+    submit(io, 0);
+    return delivered == 0 && io->recv_failed ? -1 : delivered;
+}
+
+void async_io_destroy(AsyncIo *io) {
+    if (!io) return;
+    async_io_flush(io);
+    if (!io->uring || teardown_uring(io)) {
+        free(io->pool);
+    } else {
+        // Leaked on purpose: the kernel may still write into it.
+        fprintf(stderr, "async_io: %u requests still in flight at close\n", io->inflight);
+    }
+    free(io->bufs);
+    free(io->free_stack);
+    free(io);
+}
@@ -0,0 +1,344 @@
+// deterministic.c - reproducible trig and RK4. Built with -ffp-contract=off
+// (see src/CMakeLists.txt); GCC ignores the standard pragma, Clang honours it.
+#ifdef __clang__
+#pragma STDC FP_CONTRACT OFF
+#endif
+
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "deterministic.h"
+
+// Argument reduction and kernels follow fdlibm (e_rem_pio2.c, k_sin.c,
+// k_cos.c): x = n*pi/2 + (y0 + y1), with pi/2 split Cody-Waite style into
+// 33-bit pieces so n*piece is exact for |n| < 2^20.
+static const double invpio2 = 6.36619772367581382433e-01;
+static const double pio2_1 = 1.57079632673412561417e+00;
+static const double pio2_1t = 6.07710050650619224932e-11;
+static const double pio2_2 = 6.07710050630396597660e-11;
+static const double pio2_2t = 2.02226624879595063154e-21;
+static const double pio2_3 = 2.02226624871116645580e-21;
+static const double pio2_3t = 8.47842766036889956997e-32;
+
+static const double S1 = -1.66666666666666324348e-01;
+static const double S2 = 8.33333333332248946124e-03;
+static const double S3 = -1.98412698298579493134e-04;
+static const double S4 = 2.75573137070700676789e-06;
+static const double S5 = -2.50507602534068634195e-08;
+static const double S6 = 1.58969099521155010221e-10;
+
+static const double C1 = 4.16666666666666019037e-02;
+static const double C2 = -1.38888888888741095749e-03;
+static const double C3 = 2.48015872894767294178e-05;
+static const double C4 = -2.75573143513906633035e-07;
+static const double C5 = 2.08757232129817482790e-09;
+static const double C6 = -1.13596475577881948265e-11;
+
+static inline uint32_t high_word(double x) {
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return (uint32_t)(bits >> 32);
+}
+
+// sin on [-pi/4, pi/4]; y is the tail of the reduced argument.
+static double kernel_sin(double x, double y, bool has_tail) {
+    double z = x*x;
+    double w = z*z;
+    double r = S2 + z*(S3 + z*S4) + z*w*(S5 + z*S6);
+    double v = z*x;
+    if (!has_tail) return x + v*(S1 + z*r);
+    return x - ((z*(0.5*y - v*r) - y) - v*S1);
+}
+
+static double kernel_cos(double x, double y) {
+    double z = x*x;
+    double w = z*z;
+    double r = z*(C1 + z*(C2 + z*C3)) + w*w*(C4 + z*(C5 + z*C6));
+    double hz = 0.5*z;
+    w = 1.0 - hz;
+    return w + (((1.0 - w) - hz) + (z*r - x*y));
+}
+
+// Returns n mod 4 and stores the reduced argument in y[0] + y[1].
+static int rem_pio2(double x, double y[2]) {
+    uint32_t ix = high_word(x) & 0x7fffffff;
+    if (ix >= 0x413921fb) {
+        // |x| >= 2^20 * pi/2: fold into [-pi, pi] first. remainder() is exact,
+        // so this stays reproducible, it just uses the rounded 2*pi.
+        x = remainder(x, 2.0 * M_PI);
+        ix = high_word(x) & 0x7fffffff;
+    }
+    // Round to nearest without relying on the current libm's rint().
+    double fn = (x*invpio2 + 0x1.8p52) - 0x1.8p52;
+    int n = (int)fn;
+    double r = x - fn*pio2_1;
+    double w = fn*pio2_1t;
+    int j = (int)(ix >> 20);
+    y[0] = r - w;
+    int i = j - (int)((high_word(y[0]) >> 20) & 0x7ff);
+    if (i > 16) {
+        // Cancellation: take the next 33 bits of pi/2.
+        double t = r;
+        w = fn*pio2_2;
+        r = t - w;
+        w = fn*pio2_2t - ((t - r) - w);
+        y[0] = r - w;
+        i = j - (int)((high_word(y[0]) >> 20) & 0x7ff);
+        if (i > 49) {
+            t = r;
+            w = fn*pio2_3;
+            r = t - w;
+            w = fn*pio2_3t - ((t - r) - w);
+            y[0] = r - w;
+        }
+    }
+    y[1] = (r - y[0]) - w;
+    return n & 3;
+}
+
+double det_sin(double x) {
+    uint32_t ix = high_word(x) & 0x7fffffff;
+    if (ix <= 0x3fe921fb) {                 // |x| <= pi/4
+        if (ix < 0x3e400000) return x;      // |x| < 2^-27
+        return kernel_sin(x, 0.0, false);
+    }
+    if (ix >= 0x7ff00000) return x - x;     // inf or NaN
+    double y[2];
+    switch (rem_pio2(x, y)) {
+    case 0: return kernel_sin(y[0], y[1], true);
+    case 1: return kernel_cos(y[0], y[1]);
+    case 2: return -kernel_sin(y[0], y[1], true);
+    default: return -kernel_cos(y[0], y[1]);
+    }
+}
+
+double det_cos(double x) {
+    uint32_t ix = high_word(x) & 0x7fffffff;
+    if (ix <= 0x3fe921fb) {
+        if (ix < 0x3e46a09e) return 1.0;    // |x| < 2^-27 * sqrt(2)
+        return kernel_cos(x, 0.0);
+    }
+    if (ix >= 0x7ff00000) return x - x;
+    double y[2];
+    switch (rem_pio2(x, y)) {
+    case 0: return kernel_cos(y[0], y[1]);
+    case 1: return -kernel_sin(y[0], y[1], true);
+    case 2: return -kernel_cos(y[0], y[1]);
+    default: return kernel_sin(y[0], y[1], true);
+    }
+}
+
+// accelerations() from arithmetic.c, term for term.
+static void det_accelerations(
+    double theta1, double theta2,
+    double omega1, double omega2,
+    double m1, double m2,
+    double L1, double L2,
+    double g,
+    double *theta1_dd, double *theta2_dd
+) {
+    double delta = theta1 - theta2;
+    double sin_delta = det_sin(delta);
+    double cos_delta = det_cos(delta);
+    double den = 2*m1 + m2 - m2 * det_cos(2 * delta);
+
+    *theta1_dd =
+        (-g * (2*m1 + m2) * det_sin(theta1)
+        - m2 * g * det_sin(theta1 - 2 * theta2)
+        - 2 * sin_delta * m2 *
+          (omega2*omega2*L2 + omega1*omega1*L1*cos_delta))
+        / (L1 * den);
+
+    *theta2_dd =
+        (2 * sin_delta *
+         (omega1*omega1*L1*(m1 + m2)
+        + g*(m1 + m2)*det_cos(theta1)
+        + omega2*omega2*L2*m2*cos_delta))
+        / (L2 * den);
+}
+
+void compute_deterministic(
+    double theta1, double theta2,
+    double omega1, double omega2,
+    double m1, double m2,
+    double L1, double L2,
+    double g, double dt,
+    double *new_theta1, double *new_theta2,
+    double *new_omega1, double *new_omega2
+) {
+    double h = 0.5 * dt;
+
+    double k1_omega1, k1_omega2;
+    det_accelerations(theta1, theta2, omega1, omega2,
+                      m1, m2, L1, L2, g, &k1_omega1, &k1_omega2);
+    double k1_theta1 = omega1;
+    double k1_theta2 = omega2;
+
+    double k2_omega1, k2_omega2;
+    double k2_theta1 = omega1 + h * k1_omega1;
+    double k2_theta2 = omega2 + h * k1_omega2;
+    det_accelerations(theta1 + h * k1_theta1, theta2 + h * k1_theta2,
+                      k2_theta1, k2_theta2,
+                      m1, m2, L1, L2, g, &k2_omega1, &k2_omega2);
+
+    double k3_omega1, k3_omega2;
+    double k3_theta1 = omega1 + h * k2_omega1;
+    double k3_theta2 = omega2 + h * k2_omega2;
+    det_accelerations(theta1 + h * k2_theta1, theta2 + h * k2_theta2,
+                      k3_theta1, k3_theta2,
+                      m1, m2, L1, L2, g, &k3_omega1, &k3_omega2);
+
+    double k4_omega1, k4_omega2;
+    double k4_theta1 = omega1 + dt * k3_omega1;
+    double k4_theta2 = omega2 + dt * k3_omega2;
+    det_accelerations(theta1 + dt * k3_theta1, theta2 + dt * k3_theta2,
+                      k4_theta1, k4_theta2,
+                      m1, m2, L1, L2, g, &k4_omega1, &k4_omega2);
+
+    // Explicit left-to-right sums; no reassociation is allowed here.
+    double w = dt / 6.0;
+    *new_theta1 = theta1 + w * (((k1_theta1 + 2*k2_theta1) + 2*k3_theta1) + k4_theta1);
+    *new_theta2 = theta2 + w * (((k1_theta2 + 2*k2_theta2) + 2*k3_theta2) + k4_theta2);
+    *new_omega1 = omega1 + w * (((k1_omega1 + 2*k2_omega1) + 2*k3_omega1) + k4_omega1);
+    *new_omega2 = omega2 + w * (((k1_omega2 + 2*k2_omega2) + 2*k3_omega2) + k4_omega2);
+}
+
+typedef struct {
+    double *theta1, *theta2, *omega1, *omega2;
+    size_t n;
+    double m1, m2, l1, l2, g, dt;
+    int steps;
+    double *partials;       // per-block energies, NULL when stepping
+    size_t first_block;
+    size_t last_block;
+} DetJob;
+
+static double block_energy(const DetJob *job, size_t begin, size_t end) {
+    double sum = 0.0;
+    for (size_t i = begin; i < end; i++) {
+        double t1 = job->theta1[i], t2 = job->theta2[i];
+        double w1 = job->omega1[i], w2 = job->omega2[i];
+        double k1 = 0.5 * job->m1 * job->l1 * job->l1 * w1 * w1;
+        double k2 = 0.5 * job->m2 * (job->l1 * job->l1 * w1 * w1 + job->l2 * job->l2 * w2 * w2
+                                     + 2 * job->l1 * job->l2 * w1 * w2 * det_cos(t1 - t2));
+        double v = -(job->m1 + job->m2) * job->g * job->l1 * det_cos(t1)
+                   - job->m2 * job->g * job->l2 * det_cos(t2);
+        sum += k1 + k2 + v;
+    }
+    return sum;
+}
+
+static void *det_worker(void *arg) {
+    DetJob *job = arg;
+    for (size_t b = job->first_block; b < job->last_block; b++) {
+        size_t begin = b * DETERMINISTIC_BLOCK;
+        size_t end = begin + DETERMINISTIC_BLOCK < job->n ? begin + DETERMINISTIC_BLOCK : job->n;
+        if (job->partials) {
+            job->partials[b] = block_energy(job, begin, end);
+            continue;
+        }
+        // One block at a time for all steps keeps its state in cache.
+        for (size_t i = begin; i < end; i++) {
+            double t1 = job->theta1[i], t2 = job->theta2[i];
+            double w1 = job->omega1[i], w2 = job->omega2[i];
+            for (int s = 0; s < job->steps; s++) {
+                compute_deterministic(t1, t2, w1, w2,
+                                      job->m1, job->m2, job->l1, job->l2, job->g, job->dt,
+                                      &t1, &t2, &w1, &w2);
+            }
+            job->theta1[i] = t1;
+            job->theta2[i] = t2;
+            job->omega1[i] = w1;
+            job->omega2[i] = w2;
+        }
+    }
+    return NULL;
+}
+
+// Splits the blocks into contiguous shares; the calling thread takes the
+// first one. Which thread runs a block never changes what it computes.
+static void run_blocks(const DetJob *proto, int threads) {
+    size_t blocks = (proto->n + DETERMINISTIC_BLOCK - 1) / DETERMINISTIC_BLOCK;
+    if (blocks == 0) return;
+    if (threads < 1) threads = 1;
+    if ((size_t)threads > blocks) threads = (int)blocks;
+    if (threads > 256) threads = 256;
+
+    pthread_t tids[threads];
+    bool spawned[threads];
+    DetJob jobs[threads];
+    for (int t = 0; t < threads; t++) {
+        jobs[t] = *proto;
+        jobs[t].first_block = blocks * t / threads;
+        jobs[t].last_block = blocks * (t + 1) / threads;
+        spawned[t] = t > 0 && pthread_create(&tids[t], NULL, det_worker, &jobs[t]) == 0;
+    }
+    for (int t = 0; t < threads; t++) {
+        if (!spawned[t]) det_worker(&jobs[t]);
+    }
+    for (int t = 1; t < threads; t++) {
+        if (spawned[t]) pthread_join(tids[t], NULL);
+    }
+}
+
+void compute_batch_deterministic(
+    double *theta1, double *theta2,
+    double *omega1, double *omega2,
+    size_t n,
+    double m1, double m2,
+    double L1, double L2,
+    double g, double dt,
+    int steps, int threads
+) {
+    DetJob job = { theta1, theta2, omega1, omega2, n, m1, m2, L1, L2, g, dt, steps, NULL, 0, 0 };
+    run_blocks(&job, threads);
+}
+
+double deterministic_energy(
+    const double *theta1, const double *theta2,
+    const double *omega1, const double *omega2,
+    size_t n,
+    double m1, double m2,
+    double L1, double L2,
+    double g, int threads
+) {
+    size_t blocks = (n + DETERMINISTIC_BLOCK - 1) / DETERMINISTIC_BLOCK;
+    if (blocks == 0) return 0.0;
+    double *partials = malloc(blocks * sizeof(double));
+    if (!partials) return NAN;
+    // The job never writes the state when partials is set.
+    DetJob job = { (double *)theta1, (double *)theta2, (double *)omega1, (double *)omega2,
+                   n, m1, m2, L1, L2, g, 0.0, 0, partials, 0, 0 };
+    run_blocks(&job, threads);
+    double total = 0.0;
+    for (size_t b = 0; b < blocks; b++) total += partials[b];
+    free(partials);
+    return total;
+}
+
+static void put_le(uint8_t out[8], double x) {
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    for (int i = 0; i < 8; i++) out[i] = (uint8_t)(bits >> (8 * i));
+}
+
+void deterministic_hash(
+    const double *theta1, const double *theta2,
+    const double *omega1, const double *omega2,
+    size_t n,
+    uint8_t hash[SHA256_BLOCK_SIZE]
+) {
+    SHA256_CTX ctx;
+    sha256_init(&ctx);
+    for (size_t i = 0; i < n; i++) {
+        uint8_t buf[32];
+        put_le(buf, theta1[i]);
+        put_le(buf + 8, theta2[i]);
+        put_le(buf + 16, omega1[i]);
+        put_le(buf + 24, omega2[i]);
+        sha256_update(&ctx, buf, sizeof(buf));
+    }
+    sha256_final(&ctx, hash);
+}
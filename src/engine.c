@@ -0,0 +1,152 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "pendulum_engine.h"
+#include "arithmetic.h"
+
+struct PendulumSim {
+    size_t count;
+    double dt;
+    double time;
+    PreparedConfig cfg;
+
+    // One allocation, one array per state variable.
+    double *theta1;
+    double *theta2;
+    double *omega1;
+    double *omega2;
+};
+
+static int params_valid(const PendulumSimParams *p) {
+    return p && p->m1 > 0.0 && p->m2 > 0.0 && p->l1 > 0.0 && p->l2 > 0.0 && isfinite(p->g);
+}
+
+static int range_valid(const PendulumSim *sim, size_t first, size_t count) {
+    return first <= sim->count && count <= sim->count - first;
+}
+
+unsigned pendulum_sim_api_version(void) {
+    return PENDULUM_ENGINE_API_VERSION;
+}
+
+PendulumSim *pendulum_sim_create(size_t count, const PendulumSimParams *params, double dt) {
+    // The four state arrays share one allocation.
+    if (count == 0 || count > SIZE_MAX / (4 * sizeof(double)) || !params_valid(params) ||
+        !(dt > 0.0)) {
+        return NULL;
+    }
+    PendulumSim *sim = malloc(sizeof(*sim));
+    double *state = calloc(count, 4 * sizeof(double));
+    if (!sim || !state) {
+        free(sim);
+        free(state);
+        return NULL;
+    }
+    sim->count = count;
+    sim->dt = dt;
+    sim->time = 0.0;
+    sim->theta1 = state;
+    sim->theta2 = state + count;
+    sim->omega1 = state + 2 * count;
+    sim->omega2 = state + 3 * count;
+    prepare_config(&sim->cfg, params->m1, params->m2, params->l1, params->l2, params->g);
+    return sim;
+}
+
+void pendulum_sim_destroy(PendulumSim *sim) {
+    if (!sim) return;
+    free(sim->theta1);
+    free(sim);
+}
+
+size_t pendulum_sim_count(const PendulumSim *sim) {
+    return sim ? sim->count : 0;
+}
+
+double pendulum_sim_time(const PendulumSim *sim) {
+    return sim ? sim->time : 0.0;
+}
+
+PendulumSimStatus pendulum_sim_set_params(PendulumSim *sim, const PendulumSimParams *params) {
+    if (!sim || !params_valid(params)) return PENDULUM_SIM_EINVAL;
+    prepare_config(&sim->cfg, params->m1, params->m2, params->l1, params->l2, params->g);
+    return PENDULUM_SIM_OK;
+}
+
+PendulumSimStatus pendulum_sim_set_dt(PendulumSim *sim, double dt) {
+    if (!sim || !(dt > 0.0)) return PENDULUM_SIM_EINVAL;
+    sim->dt = dt;
+    return PENDULUM_SIM_OK;
+}
+
+PendulumSimStatus pendulum_sim_set_state(PendulumSim *sim, size_t first, size_t count,
+                                         const PendulumSimState *states) {
+    if (!sim || (!states && count > 0)) return PENDULUM_SIM_EINVAL;
+    if (!range_valid(sim, first, count)) return PENDULUM_SIM_ERANGE;
+    for (size_t i = 0; i < count; i++) {
+        sim->theta1[first + i] = states[i].theta1;
+        sim->theta2[first + i] = states[i].theta2;
+        sim->omega1[first + i] = states[i].omega1;
+        sim->omega2[first + i] = states[i].omega2;
+    }
+    return PENDULUM_SIM_OK;
+}
+
+PendulumSimStatus pendulum_sim_get_state(const PendulumSim *sim, size_t first, size_t count,
+                                         PendulumSimState *out) {
+    if (!sim || (!out && count > 0)) return PENDULUM_SIM_EINVAL;
+    if (!range_valid(sim, first, count)) return PENDULUM_SIM_ERANGE;
+    for (size_t i = 0; i < count; i++) {
+        out[i].theta1 = sim->theta1[first + i];
+        out[i].theta2 = sim->theta2[first + i];
+        out[i].omega1 = sim->omega1[first + i];
+        out[i].omega2 = sim->omega2[first + i];
+    }
+    return PENDULUM_SIM_OK;
+}
+
+PendulumSimStatus pendulum_sim_step(PendulumSim *sim, size_t steps) {
+    if (!sim) return PENDULUM_SIM_EINVAL;
+    for (size_t s = 0; s < steps; s++) {
+        compute_batch_prepared(&sim->cfg, sim->theta1, sim->theta2, sim->omega1, sim->omega2,
+                               sim->count, sim->dt);
+    }
+    sim->time += (double)steps * sim->dt;
+    return PENDULUM_SIM_OK;
+}
+
+static double extract_one(const PendulumSim *sim, PendulumSimQuantity quantity, size_t i) {
+    const PreparedConfig *c = &sim->cfg;
+    double t1 = sim->theta1[i], t2 = sim->theta2[i];
+    double w1 = sim->omega1[i], w2 = sim->omega2[i];
+    switch (quantity) {
+    case PENDULUM_SIM_THETA1: return t1;
+    case PENDULUM_SIM_THETA2: return t2;
+    case PENDULUM_SIM_OMEGA1: return w1;
+    case PENDULUM_SIM_OMEGA2: return w2;
+    case PENDULUM_SIM_BOB1_X: return c->l1 * sin(t1);
+    case PENDULUM_SIM_BOB1_Y: return -c->l1 * cos(t1);
+    case PENDULUM_SIM_BOB2_X: return c->l1 * sin(t1) + c->l2 * sin(t2);
+    case PENDULUM_SIM_BOB2_Y: return -c->l1 * cos(t1) - c->l2 * cos(t2);
+    case PENDULUM_SIM_ENERGY: {
+        double k1 = 0.5 * c->m1 * c->l1 * c->l1 * w1 * w1;
+        double k2 = 0.5 * c->m2 * (c->l1 * c->l1 * w1 * w1 + c->l2 * c->l2 * w2 * w2
+                                   + 2 * c->l1 * c->l2 * w1 * w2 * cos(t1 - t2));
+        double v = -(c->m1 + c->m2) * c->g * c->l1 * cos(t1) - c->m2 * c->g * c->l2 * cos(t2);
+        return k1 + k2 + v;
+    }
+    }
+    return NAN;
+}
+
+PendulumSimStatus pendulum_sim_extract(const PendulumSim *sim, PendulumSimQuantity quantity,
+                                       size_t first, size_t count, double *out) {
+    if (!sim || (!out && count > 0) || (unsigned)quantity > PENDULUM_SIM_ENERGY) {
+        return PENDULUM_SIM_EINVAL;
+    }
+    if (!range_valid(sim, first, count)) return PENDULUM_SIM_ERANGE;
+    for (size_t i = 0; i < count; i++) {
+        out[i] = extract_one(sim, quantity, first + i);
+    }
+    return PENDULUM_SIM_OK;
+}
@@ -0,0 +1,368 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "ensemble.h"
+#include "arithmetic.h"
+
+// Bump allocator over an anonymous mapping. Reserving address space is free;
+// physical pages are only committed when first written.
+typedef struct {
+    char *base;
+    size_t size;
+    size_t used;
+} Arena;
+
+typedef struct {
+    uint32_t next;
+    uint32_t filled;
+    float xy[];
+} TrailRing;
+
+// Per-pendulum data that stepping never reads.
+typedef struct {
+    unsigned char color_r, color_g, color_b;
+    int32_t trail;          // ring index in the trail arena, -1 if none
+} EnsembleCold;
+
+typedef enum { TASK_FIRST_TOUCH, TASK_STEP, TASK_QUIT } EnsembleTask;
+
+typedef struct {
+    Ensemble *e;
+    size_t begin;
+    size_t end;
+    pthread_t tid;
+} Worker;
+
+struct Ensemble {
+    size_t count;
+    size_t padded;
+    EnsembleOptions opts;
+
+    Arena hot;
+    Arena cold;
+    Arena trails;
+
+    double *theta1;
+    double *theta2;
+    double *omega1;
+    double *omega2;
+    uint8_t *config;
+
+    EnsembleCold *cold_data;
+    size_t ring_bytes;
+    int32_t rings_used;
+
+    PreparedConfig configs[ENSEMBLE_MAX_CONFIGS];
+    int config_count;
+    uint64_t steps_taken;
+
+    Worker *workers;
+    int worker_count;
+    int threads_started;
+    pthread_mutex_t lock;
+    pthread_cond_t start_cv;
+    pthread_cond_t done_cv;
+    uint64_t generation;
+    int pending;
+    EnsembleTask task;
+    double dt;
+    size_t steps;
+};
+
+static size_t page_size(void) {
+    long p = sysconf(_SC_PAGESIZE);
+    return p > 0 ? (size_t)p : 4096;
+}
+
+// Hot arrays are split between workers in whole pages, so each page is first
+// touched, and therefore placed on a NUMA node, by the thread that steps it.
+static size_t doubles_per_page(void) {
+    return page_size() / sizeof(double);
+}
+
+static size_t round_up(size_t v, size_t to) {
+    return (v + to - 1) / to * to;
+}
+
+static bool arena_reserve(Arena *a, size_t size) {
+    a->size = round_up(size ? size : 1, page_size());
+    a->used = 0;
+    a->base = mmap(NULL, a->size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (a->base == MAP_FAILED) {
+        a->base = NULL;
+        return false;
+    }
+    return true;
+}
+
+static void *arena_alloc(Arena *a, size_t bytes, size_t align) {
+    size_t offset = round_up(a->used, align);
+    if (!a->base || offset + bytes > a->size) return NULL;
+    a->used = offset + bytes;
+    return a->base + offset;
+}
+
+static void arena_release(Arena *a) {
+    if (a->base) munmap(a->base, a->size);
+    a->base = NULL;
+    a->size = a->used = 0;
+}
+
+static TrailRing *trail_ring(const Ensemble *e, int32_t index) {
+    return (TrailRing *)(e->trails.base + (size_t)index * e->ring_bytes);
+}
+
+static void record_trails(Ensemble *e, size_t begin, size_t end) {
+    size_t len = e->opts.trail_length;
+    for (size_t i = begin; i < end; i++) {
+        int32_t t = e->cold_data[i].trail;
+        if (t < 0) continue;
+        const PreparedConfig *c = &e->configs[e->config[i]];
+        TrailRing *ring = trail_ring(e, t);
+        ring->xy[2 * ring->next] = (float)(c->l1 * sin(e->theta1[i]) + c->l2 * sin(e->theta2[i]));
+        ring->xy[2 * ring->next + 1] = (float)(-c->l1 * cos(e->theta1[i]) - c->l2 * cos(e->theta2[i]));
+        ring->next = (ring->next + 1) % len;
+        if (ring->filled < len) ring->filled++;
+    }
+}
+
+static void run_task(Ensemble *e, EnsembleTask task, size_t begin, size_t end) {
+    if (task == TASK_FIRST_TOUCH) {
+        size_t n = end - begin;
+        memset(e->theta1 + begin, 0, n * sizeof(double));
+        memset(e->theta2 + begin, 0, n * sizeof(double));
+        memset(e->omega1 + begin, 0, n * sizeof(double));
+        memset(e->omega2 + begin, 0, n * sizeof(double));
+        memset(e->config + begin, 0, n);
+        return;
+    }
+    if (task != TASK_STEP) return;
+
+    unsigned decimation = e->opts.trail_decimation ? e->opts.trail_decimation : 1;
+    bool trails = e->opts.trail_length > 0 && e->rings_used > 0;
+    for (size_t s = 1; s <= e->steps; s++) {
+        for (size_t i = begin; i < end; i++) {
+            compute_prepared(&e->configs[e->config[i]],
+                             e->theta1[i], e->theta2[i], e->omega1[i], e->omega2[i], e->dt,
+                             &e->theta1[i], &e->theta2[i], &e->omega1[i], &e->omega2[i]);
+        }
+        if (trails && (e->steps_taken + s) % decimation == 0) {
+            record_trails(e, begin, end);
+        }
+    }
+}
+
+static void *worker_main(void *arg) {
+    Worker *w = arg;
+    Ensemble *e = w->e;
+    uint64_t seen = 0;
+    for (;;) {
+        pthread_mutex_lock(&e->lock);
+        while (e->generation == seen) pthread_cond_wait(&e->start_cv, &e->lock);
+        seen = e->generation;
+        EnsembleTask task = e->task;
+        pthread_mutex_unlock(&e->lock);
+
+        if (task == TASK_QUIT) return NULL;
+        run_task(e, task, w->begin, w->end);
+
+        pthread_mutex_lock(&e->lock);
+        if (--e->pending == 0) pthread_cond_signal(&e->done_cv);
+        pthread_mutex_unlock(&e->lock);
+    }
+}
+
+// Runs a step or first-touch task on every worker's slice and waits for all
+// of them. With a single worker everything happens on the calling thread.
+static void dispatch(Ensemble *e, EnsembleTask task) {
+    if (e->worker_count == 1) {
+        run_task(e, task, 0, e->count);
+        return;
+    }
+    pthread_mutex_lock(&e->lock);
+    e->task = task;
+    e->pending = e->worker_count;
+    e->generation++;
+    pthread_cond_broadcast(&e->start_cv);
+    while (e->pending > 0) pthread_cond_wait(&e->done_cv, &e->lock);
+    pthread_mutex_unlock(&e->lock);
+}
+
+void ensemble_default_options(EnsembleOptions *opts) {
+    opts->threads = 1;
+    opts->trail_length = 0;
+    opts->trail_decimation = 1;
+}
+
+static bool start_workers(Ensemble *e) {
+    size_t chunk = round_up((e->count + e->opts.threads - 1) / e->opts.threads, doubles_per_page());
+    int n = (int)((e->count + chunk - 1) / chunk);
+    e->workers = calloc(n, sizeof(Worker));
+    if (!e->workers) return false;
+    for (int t = 0; t < n; t++) {
+        e->workers[t].e = e;
+        e->workers[t].begin = t * chunk;
+        e->workers[t].end = (t + 1) * chunk < e->count ? (t + 1) * chunk : e->count;
+    }
+    e->worker_count = n;
+    if (n == 1) return true;
+
+    pthread_mutex_init(&e->lock, NULL);
+    pthread_cond_init(&e->start_cv, NULL);
+    pthread_cond_init(&e->done_cv, NULL);
+    for (int t = 0; t < n; t++) {
+        if (pthread_create(&e->workers[t].tid, NULL, worker_main, &e->workers[t]) != 0) {
+            return false;
+        }
+        e->threads_started++;
+    }
+    return true;
+}
+
+static void stop_workers(Ensemble *e) {
+    if (e->threads_started > 0) {
+        pthread_mutex_lock(&e->lock);
+        e->task = TASK_QUIT;
+        e->generation++;
+        pthread_cond_broadcast(&e->start_cv);
+        pthread_mutex_unlock(&e->lock);
+        for (int t = 0; t < e->threads_started; t++) pthread_join(e->workers[t].tid, NULL);
+    }
+    if (e->worker_count > 1) {
+        pthread_mutex_destroy(&e->lock);
+        pthread_cond_destroy(&e->start_cv);
+        pthread_cond_destroy(&e->done_cv);
+    }
+    free(e->workers);
+    e->workers = NULL;
+}
+
+Ensemble *ensemble_create(size_t count, const EnsembleOptions *opts) {
+    if (count == 0 || count > INT32_MAX || !opts || opts->threads < 1 || opts->threads > 1024) {
+        return NULL;
+    }
+    Ensemble *e = calloc(1, sizeof(*e));
+    if (!e) return NULL;
+    e->count = count;
+    e->opts = *opts;
+    e->padded = round_up(count, doubles_per_page());
+
+    size_t hot_bytes = 4 * e->padded * sizeof(double) + e->padded + 5 * page_size();
+    size_t cold_bytes = count * sizeof(EnsembleCold) + page_size();
+    if (!arena_reserve(&e->hot, hot_bytes) || !arena_reserve(&e->cold, cold_bytes)) {
+        ensemble_destroy(e);
+        return NULL;
+    }
+    size_t pg = page_size();
+    e->theta1 = arena_alloc(&e->hot, e->padded * sizeof(double), pg);
+    e->theta2 = arena_alloc(&e->hot, e->padded * sizeof(double), pg);
+    e->omega1 = arena_alloc(&e->hot, e->padded * sizeof(double), pg);
+    e->omega2 = arena_alloc(&e->hot, e->padded * sizeof(double), pg);
+    e->config = arena_alloc(&e->hot, e->padded, pg);
+    e->cold_data = arena_alloc(&e->cold, count * sizeof(EnsembleCold), 64);
+    if (opts->trail_length > 0) {
+        e->ring_bytes = round_up(sizeof(TrailRing) + 2 * opts->trail_length * sizeof(float), 64);
+    }
+
+    if (!start_workers(e)) {
+        ensemble_destroy(e);
+        return NULL;
+    }
+    dispatch(e, TASK_FIRST_TOUCH);
+    for (size_t i = 0; i < count; i++) {
+        e->cold_data[i].trail = -1;
+    }
+    return e;
+}
+
+void ensemble_destroy(Ensemble *e) {
+    if (!e) return;
+    stop_workers(e);
+    arena_release(&e->hot);
+    arena_release(&e->cold);
+    arena_release(&e->trails);
+    free(e);
+}
+
+size_t ensemble_count(const Ensemble *e) {
+    return e->count;
+}
+
+int ensemble_add_config(Ensemble *e, double m1, double m2, double l1, double l2, double g) {
+    if (e->config_count >= ENSEMBLE_MAX_CONFIGS) return -1;
+    prepare_config(&e->configs[e->config_count], m1, m2, l1, l2, g);
+    return e->config_count++;
+}
+
+bool ensemble_set_pendulum(Ensemble *e, size_t index, int config, const PendulumState *state,
+                           unsigned char r, unsigned char g, unsigned char b) {
+    if (index >= e->count || config < 0 || config >= e->config_count) return false;
+    e->theta1[index] = state->theta1;
+    e->theta2[index] = state->theta2;
+    e->omega1[index] = state->omega1;
+    e->omega2[index] = state->omega2;
+    e->config[index] = (uint8_t)config;
+    e->cold_data[index].color_r = r;
+    e->cold_data[index].color_g = g;
+    e->cold_data[index].color_b = b;
+    int32_t t = e->cold_data[index].trail;
+    if (t >= 0) {
+        trail_ring(e, t)->next = 0;
+        trail_ring(e, t)->filled = 0;
+    }
+    return true;
+}
+
+void ensemble_get_state(const Ensemble *e, size_t index, PendulumState *out) {
+    out->theta1 = e->theta1[index];
+    out->theta2 = e->theta2[index];
+    out->omega1 = e->omega1[index];
+    out->omega2 = e->omega2[index];
+}
+
+bool ensemble_enable_trail(Ensemble *e, size_t index) {
+    if (index >= e->count || e->opts.trail_length == 0) return false;
+    if (e->cold_data[index].trail >= 0) return true;
+    if (!e->trails.base && !arena_reserve(&e->trails, e->count * e->ring_bytes)) {
+        return false;
+    }
+    TrailRing *ring = arena_alloc(&e->trails, e->ring_bytes, 64);
+    if (!ring) return false;
+    ring->next = 0;
+    ring->filled = 0;
+    e->cold_data[index].trail = e->rings_used++;
+    return true;
+}
+
+size_t ensemble_trail(const Ensemble *e, size_t index, float *xy, size_t max_points) {
+    if (index >= e->count || e->cold_data[index].trail < 0) return 0;
+    const TrailRing *ring = trail_ring(e, e->cold_data[index].trail);
+    size_t len = e->opts.trail_length;
+    size_t n = ring->filled < max_points ? ring->filled : max_points;
+    size_t oldest = (ring->next + len - ring->filled) % len;
+    size_t first = oldest + (ring->filled - n);
+    for (size_t k = 0; k < n; k++) {
+        size_t j = (first + k) % len;
+        xy[2 * k] = ring->xy[2 * j];
+        xy[2 * k + 1] = ring->xy[2 * j + 1];
+    }
+    return n;
+}
+
+void ensemble_step(Ensemble *e, double dt, size_t steps) {
+    if (e->config_count == 0 || steps == 0) return;
+    e->dt = dt;
+    e->steps = steps;
+    dispatch(e, TASK_STEP);
+    e->steps_taken += steps;
+}
+
+size_t ensemble_memory_bytes(const Ensemble *e) {
+    size_t pg = page_size();
+    return round_up(e->hot.used, pg) + round_up(e->cold.used, pg) + round_up(e->trails.used, pg);
+}
@@ -0,0 +1,132 @@
+#include <math.h>
+#include "events.h"
+
+#define EVENT_MAX_ITERATIONS 60
+
+typedef struct {
+    PendulumState y0, y1;
+    double d0[4], d1[4];    // time derivatives at both ends
+    double dt;
+} StepInterpolant;
+
+static void derivative(const PreparedConfig *cfg, const PendulumState *s, double d[4]) {
+    d[0] = s->omega1;
+    d[1] = s->omega2;
+    accelerations_prepared(cfg, s->theta1, s->theta2, s->omega1, s->omega2, &d[2], &d[3]);
+}
+
+static double hermite(double y0, double y1, double d0, double d1, double dt, double u) {
+    double u2 = u * u, u3 = u2 * u;
+    return (2*u3 - 3*u2 + 1) * y0 + (u3 - 2*u2 + u) * dt * d0
+         + (-2*u3 + 3*u2) * y1 + (u3 - u2) * dt * d1;
+}
+
+static void interpolate(const StepInterpolant *h, double u, PendulumState *out) {
+    out->theta1 = hermite(h->y0.theta1, h->y1.theta1, h->d0[0], h->d1[0], h->dt, u);
+    out->theta2 = hermite(h->y0.theta2, h->y1.theta2, h->d0[1], h->d1[1], h->dt, u);
+    out->omega1 = hermite(h->y0.omega1, h->y1.omega1, h->d0[2], h->d1[2], h->dt, u);
+    out->omega2 = hermite(h->y0.omega2, h->y1.omega2, h->d0[3], h->d1[3], h->dt, u);
+}
+
+// Illinois (modified regula falsi) on the interpolated event function over
+// the step fraction [0, 1], where g changes sign.
+static double locate(const StepInterpolant *h, const EventSpec *e, double g0, double g1) {
+    // An end exactly on the surface is the root; bracketing below needs
+    // strict signs at both ends.
+    if (g1 == 0.0) return 1.0;
+    if (g0 == 0.0) return 0.0;
+    double a = 0.0, b = 1.0, ga = g0, gb = g1;
+    int side = 0;
+    double u = 0.5;
+    for (int i = 0; i < EVENT_MAX_ITERATIONS && b - a > 1e-15; i++) {
+        u = (a * gb - b * ga) / (gb - ga);
+        if (!(u > a && u < b)) u = 0.5 * (a + b);
+        PendulumState s;
+        interpolate(h, u, &s);
+        double g = e->fn(&s, e->ctx);
+        if (g == 0.0) break;
+        if ((g > 0) == (gb > 0)) {
+            b = u;
+            gb = g;
+            if (side == -1) ga *= 0.5;
+            side = -1;
+        } else {
+            a = u;
+            ga = g;
+            if (side == 1) gb *= 0.5;
+            side = 1;
+        }
+    }
+    return u;
+}
+
+static bool crossed(EventDirection dir, double g0, double g1) {
+    bool rising = g0 < 0.0 && g1 >= 0.0;
+    bool falling = g0 > 0.0 && g1 <= 0.0;
+    if (dir == EVENT_RISING) return rising;
+    if (dir == EVENT_FALLING) return falling;
+    return rising || falling;
+}
+
+size_t event_step(const PreparedConfig *cfg, PendulumState *state, double t, double dt,
+                  const EventSpec *events, size_t event_count,
+                  EventHit *hits, size_t max_hits) {
+    StepInterpolant h;
+    h.y0 = *state;
+    h.dt = dt;
+    compute_prepared(cfg, state->theta1, state->theta2, state->omega1, state->omega2, dt,
+                     &h.y1.theta1, &h.y1.theta2, &h.y1.omega1, &h.y1.omega2);
+    *state = h.y1;
+
+    size_t n = 0;
+    bool have_derivatives = false;
+    for (size_t k = 0; k < event_count; k++) {
+        const EventSpec *e = &events[k];
+        double g0 = e->fn(&h.y0, e->ctx);
+        double g1 = e->fn(&h.y1, e->ctx);
+        if (!crossed(e->direction, g0, g1)) continue;
+
+        // Only steps that contain a crossing pay for the end derivatives.
+        if (!have_derivatives) {
+            derivative(cfg, &h.y0, h.d0);
+            derivative(cfg, &h.y1, h.d1);
+            have_derivatives = true;
+        }
+        double u = locate(&h, e, g0, g1);
+        EventHit hit;
+        hit.event = (int)k;
+        hit.t = t + u * dt;
+        interpolate(&h, u, &hit.state);
+        if (e->accept && !e->accept(&hit.state, e->ctx)) continue;
+        if (n == max_hits) break;
+
+        // Insertion keeps hits from different events in time order.
+        size_t i = n++;
+        while (i > 0 && hits[i - 1].t > hit.t) {
+            hits[i] = hits[i - 1];
+            i--;
+        }
+        hits[i] = hit;
+    }
+    return n;
+}
+
+double event_theta1_section(const PendulumState *s, void *ctx) {
+    (void)ctx;
+    return sin(s->theta1);
+}
+
+bool event_accept_theta1_down(const PendulumState *s, void *ctx) {
+    (void)ctx;
+    return cos(s->theta1) > 0.0;
+}
+
+double event_flip1(const PendulumState *s, void *ctx) {
+    (void)ctx;
+    return cos(0.5 * s->theta1);
+}
+
+double event_flip2(const PendulumState *s, void *ctx) {
+    (void)ctx;
+    return cos(0.5 * s->theta2);
+}
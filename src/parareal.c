@@ -0,0 +1,179 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "parareal.h"
+
+typedef struct {
+    const PreparedConfig *cfg;
+    const PendulumState *starts;
+    PendulumState *ends;
+    int first;
+    int last;
+    int stride;
+    double slice_len;
+    double dt;
+} SliceJob;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Integrates over exactly `duration`, shrinking dt slightly so the last step
+// lands on the slice boundary.
+static void propagate(const PreparedConfig *cfg, const PendulumState *in,
+                      double duration, double dt, PendulumState *out) {
+    int steps = (int)ceil(duration / dt - 1e-9);
+    if (steps < 1) steps = 1;
+    double h = duration / steps;
+    PendulumState s = *in;
+    for (int i = 0; i < steps; i++) {
+        compute_prepared(cfg, s.theta1, s.theta2, s.omega1, s.omega2, h,
+                         &s.theta1, &s.theta2, &s.omega1, &s.omega2);
+    }
+    *out = s;
+}
+
+static double state_distance(const PendulumState *a, const PendulumState *b) {
+    double d = fabs(a->theta1 - b->theta1);
+    d = fmax(d, fabs(a->theta2 - b->theta2));
+    d = fmax(d, fabs(a->omega1 - b->omega1));
+    d = fmax(d, fabs(a->omega2 - b->omega2));
+    return d;
+}
+
+static void *fine_worker(void *arg) {
+    SliceJob *job = arg;
+    for (int n = job->first; n < job->last; n += job->stride) {
+        propagate(job->cfg, &job->starts[n], job->slice_len, job->dt, &job->ends[n]);
+    }
+    return NULL;
+}
+
+// Fine-propagates slices [first, slices) across the worker threads; the
+// calling thread takes the first share.
+static void fine_sweep(const PreparedConfig *cfg, const PendulumState *starts, PendulumState *ends,
+                       int first, int slices, int threads, double slice_len, double dt) {
+    int workers = slices - first < threads ? slices - first : threads;
+    if (workers < 1) return;
+    pthread_t tids[workers];
+    bool spawned[workers];
+    SliceJob jobs[workers];
+    for (int t = 0; t < workers; t++) {
+        jobs[t] = (SliceJob){ cfg, starts, ends, first + t, slices, workers, slice_len, dt };
+        spawned[t] = t > 0 && pthread_create(&tids[t], NULL, fine_worker, &jobs[t]) == 0;
+    }
+    for (int t = 0; t < workers; t++) {
+        if (!spawned[t]) fine_worker(&jobs[t]);
+    }
+    for (int t = 1; t < workers; t++) {
+        if (spawned[t]) pthread_join(tids[t], NULL);
+    }
+}
+
+void parareal_default_options(PararealOptions *opts, double t_end) {
+    opts->t_end = t_end;
+    opts->slices = 8;
+    opts->threads = 8;
+    opts->fine_dt = 0.001;
+    opts->coarse_dt = 0.05;
+    opts->tolerance = 1e-8;
+    opts->max_iterations = 0;
+    opts->measure_serial = false;
+}
+
+void parareal_serial(const PreparedConfig *cfg, const PendulumState *initial,
+                     double t_end, double dt, PendulumState *out) {
+    propagate(cfg, initial, t_end, dt, out);
+}
+
+bool parareal_solve(const PreparedConfig *cfg, const PendulumState *initial,
+                    const PararealOptions *opts, PararealResult *result) {
+    int slices = opts->slices;
+    int threads = opts->threads < slices ? opts->threads : slices;
+    if (slices < 1 || threads < 1 || threads > 256 || opts->t_end <= 0.0 ||
+        opts->fine_dt <= 0.0 || opts->coarse_dt <= 0.0) {
+        return false;
+    }
+    int max_iter = opts->max_iterations > 0 ? opts->max_iterations : slices;
+    double slice_len = opts->t_end / slices;
+
+    PendulumState *u = malloc((slices + 1) * sizeof(PendulumState));
+    PendulumState *fine = malloc(slices * sizeof(PendulumState));
+    PendulumState *coarse = malloc(slices * sizeof(PendulumState));
+    if (!u || !fine || !coarse) {
+        free(u);
+        free(fine);
+        free(coarse);
+        return false;
+    }
+
+    memset(result, 0, sizeof(*result));
+    double start = now_seconds();
+
+    // Initial guess: one serial coarse sweep.
+    u[0] = *initial;
+    for (int n = 0; n < slices; n++) {
+        propagate(cfg, &u[n], slice_len, opts->coarse_dt, &coarse[n]);
+        u[n + 1] = coarse[n];
+    }
+
+    int k = 0;
+    double defect = INFINITY;
+    int stable_prefix = 0;
+    while (k < max_iter) {
+        // After k corrections the first k boundaries are exact, so their
+        // fine results from earlier sweeps are still valid.
+        fine_sweep(cfg, u, fine, k, slices, threads, slice_len, opts->fine_dt);
+        k++;
+
+        defect = 0.0;
+        stable_prefix = -1;
+        for (int n = 0; n < slices; n++) {
+            PendulumState g;
+            propagate(cfg, &u[n], slice_len, opts->coarse_dt, &g);
+            PendulumState next = {
+                g.theta1 + fine[n].theta1 - coarse[n].theta1,
+                g.theta2 + fine[n].theta2 - coarse[n].theta2,
+                g.omega1 + fine[n].omega1 - coarse[n].omega1,
+                g.omega2 + fine[n].omega2 - coarse[n].omega2,
+            };
+            coarse[n] = g;
+            double change = state_distance(&next, &u[n + 1]);
+            if (change >= opts->tolerance && stable_prefix < 0) stable_prefix = n;
+            defect = fmax(defect, change);
+            u[n + 1] = next;
+        }
+        if (stable_prefix < 0) stable_prefix = slices;
+        if (defect < opts->tolerance) break;
+    }
+
+    result->parallel_seconds = now_seconds() - start;
+    result->final_state = u[slices];
+    result->iterations = k;
+    result->defect = defect;
+    result->converged = defect < opts->tolerance;
+    result->converged_until = stable_prefix * slice_len;
+    result->iteration_bound = (double)threads / k;
+    result->chaos_limited = !result->converged || result->iteration_bound <= 1.0;
+
+    if (opts->measure_serial) {
+        // Same slice-aligned stepping as the fine sweeps, so a converged
+        // run matches it to within the tolerance.
+        PendulumState s = *initial;
+        start = now_seconds();
+        for (int n = 0; n < slices; n++) {
+            propagate(cfg, &s, slice_len, opts->fine_dt, &s);
+        }
+        result->serial_seconds = now_seconds() - start;
+        result->speedup = result->serial_seconds / result->parallel_seconds;
+    }
+
+    free(u);
+    free(fine);
+    free(coarse);
+    return true;
+}
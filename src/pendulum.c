@@ -3,6 +3,7 @@
 #include <pthread.h>
 #include "pendulum.h"
 #include "arithmetic.h"
+#include "deterministic.h"
 
 void init_pendulum(Pendulum *p,
                    double m1_val, double m2_val, double l1_val, double l2_val, double g_val,
@@ -29,12 +30,10 @@ void init_pendulum(Pendulum *p,
     p->color_r = r_val;
     p->color_g = g_val_color;
     p->color_b = b_val;
+    // No need to clear the trail arrays: entries are only read once they
+    // have been written since the last reset.
     p->trail_index = 0;
     p->trail_full = false;
-    for (int i = 0; i < TRAIL_LENGTH; i++) {
-        p->trail_x[i] = 0;
-        p->trail_y[i] = 0;
-    }
 }
 
 static void get_screen_coords(const Pendulum *p, double pixels_per_meter, int screen_width, int screen_height,
@@ -61,7 +60,11 @@ void update_pendulum(Pendulum *p, double dt, double pixels_per_meter, int screen
     double l2 = p->l2;
     double g = p->g;
     double new_theta1, new_theta2, new_omega1, new_omega2;
+#ifdef PENDULUM_DETERMINISTIC
+    compute_deterministic(
+#else
     compute(
+#endif
         theta1, theta2,
         omega1, omega2,
         m1, m2,
@@ -93,6 +96,10 @@ void update_pendulum(Pendulum *p, double dt, double pixels_per_meter, int screen
     p->trail_index = trail_index;
 }
 
+void prepare_pendulum_config(const Pendulum *p, PreparedConfig *cfg) {
+    prepare_config(cfg, p->m1, p->m2, p->l1, p->l2, p->g);
+}
+
 static pthread_mutex_t pendulum_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 void update_pendulum_threadsafe(Pendulum *p, double dt, double pix_per_m, int screen_w, int screen_h) {
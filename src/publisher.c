@@ -0,0 +1,325 @@
+#ifdef __linux__
+#define _GNU_SOURCE     // sendmmsg()
+#endif
+#include <errno.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "publisher.h"
+#include "pendulum.h"
+
+#define TOPIC_COUNT 4
+
+// Messages handed to one sendmmsg() call (the kernel caps it at UIO_MAXIOV).
+#define SEND_CHUNK 1024
+
+typedef struct {
+    struct sockaddr_in addr;
+    unsigned topics;
+    unsigned decimation;
+    unsigned countdown[TOPIC_COUNT];    // batches to skip before the next send
+} Subscriber;
+
+struct Publisher {
+    int sock;
+    bool multicast;
+    Subscriber subs[PUBLISHER_MAX_SUBSCRIBERS];
+    int count;
+    uint64_t sequence[TOPIC_COUNT];
+    uint64_t datagrams;
+
+    // Reused between batches: the serialized datagrams and the messages
+    // pointing at them, one per (datagram, subscriber).
+    char *buf;
+    struct iovec *iov;
+    size_t *lens;
+    size_t iov_capacity;
+#ifdef __linux__
+    struct mmsghdr *msgs;
+    size_t msgs_capacity;
+#endif
+    const Subscriber **due;
+};
+
+static int topic_index(unsigned topic) {
+    switch (topic) {
+    case PUBLISH_STATE: return 0;
+    case PUBLISH_SAMPLES: return 1;
+    case PUBLISH_RANDOM: return 2;
+    case PUBLISH_TEXT: return 3;
+    default: return -1;
+    }
+}
+
+size_t publish_record_size(unsigned topic) {
+    switch (topic) {
+    case PUBLISH_STATE: return sizeof(PendulumState);
+    case PUBLISH_SAMPLES: return sizeof(PublishSample);
+    case PUBLISH_RANDOM:
+    case PUBLISH_TEXT: return sizeof(uint64_t);
+    default: return 0;
+    }
+}
+
+Publisher *publisher_create(void) {
+    Publisher *pub = calloc(1, sizeof(*pub));
+    if (!pub) return NULL;
+    pub->due = calloc(PUBLISHER_MAX_SUBSCRIBERS, sizeof(*pub->due));
+    pub->sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (pub->sock < 0 || !pub->due) {
+        if (pub->sock < 0) perror("publisher socket");
+        else close(pub->sock);
+        free(pub->due);
+        free(pub);
+        return NULL;
+    }
+    return pub;
+}
+
+void publisher_destroy(Publisher *pub) {
+    if (!pub) return;
+    close(pub->sock);
+    free(pub->buf);
+    free(pub->iov);
+    free(pub->lens);
+#ifdef __linux__
+    free(pub->msgs);
+#endif
+    free(pub->due);
+    free(pub);
+}
+
+int publisher_subscribers(const Publisher *pub) {
+    return pub->count;
+}
+
+uint64_t publisher_datagrams_sent(const Publisher *pub) {
+    return pub->datagrams;
+}
+
+bool publisher_wants(const Publisher *pub, PublishTopic topic) {
+    for (int i = 0; i < pub->count; i++) {
+        if (pub->subs[i].topics & topic) return true;
+    }
+    return false;
+}
+
+int publisher_add(Publisher *pub, const char *dest, unsigned topics, unsigned decimation) {
+    if (pub->count >= PUBLISHER_MAX_SUBSCRIBERS || (topics & (PUBLISH_ALL | PUBLISH_TEXT)) == 0) {
+        return -1;
+    }
+    const char *colon = strrchr(dest, ':');
+    char *end;
+    long port = colon ? strtol(colon + 1, &end, 10) : 0;
+    if (!colon || colon == dest || *end != '\0' || port <= 0 || port > 65535) {
+        fprintf(stderr, "publisher: bad destination '%s', expected host:port\n", dest);
+        return -1;
+    }
+    char host[256];
+    snprintf(host, sizeof(host), "%.*s", (int)(colon - dest), dest);
+
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    int rc = getaddrinfo(host, NULL, &hints, &res);
+    if (rc != 0) {
+        fprintf(stderr, "publisher: %s: %s\n", host, gai_strerror(rc));
+        return -1;
+    }
+    Subscriber *s = &pub->subs[pub->count];
+    memset(s, 0, sizeof(*s));
+    memcpy(&s->addr, res->ai_addr, sizeof(s->addr));
+    freeaddrinfo(res);
+    s->addr.sin_port = htons((uint16_t)port);
+    s->topics = topics & (PUBLISH_ALL | PUBLISH_TEXT);
+    s->decimation = decimation ? decimation : 1;
+
+    // Local subscribers of a group on this host must see it too.
+    if (IN_MULTICAST(ntohl(s->addr.sin_addr.s_addr)) && !pub->multicast) {
+        unsigned char ttl = 1, loop = 1;
+        if (setsockopt(pub->sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0 ||
+            setsockopt(pub->sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0) {
+            perror("publisher multicast");
+            return -1;
+        }
+        pub->multicast = true;
+    }
+    return pub->count++;
+}
+
+static bool parse_topics(const char *text, unsigned *topics) {
+    *topics = 0;
+    char copy[128];
+    snprintf(copy, sizeof(copy), "%s", text);
+    char *save;
+    for (char *t = strtok_r(copy, ",", &save); t; t = strtok_r(NULL, ",", &save)) {
+        if (strcmp(t, "state") == 0) *topics |= PUBLISH_STATE;
+        else if (strcmp(t, "samples") == 0) *topics |= PUBLISH_SAMPLES;
+        else if (strcmp(t, "random") == 0) *topics |= PUBLISH_RANDOM;
+        else if (strcmp(t, "text") == 0) *topics |= PUBLISH_TEXT;
+        else if (strcmp(t, "all") == 0) *topics |= PUBLISH_ALL;
+        else return false;
+    }
+    return *topics != 0;
+}
+
+bool publisher_add_spec(Publisher *pub, const char *spec) {
+    char *copy = strdup(spec);
+    if (!copy) return false;
+    bool ok = true;
+    char *save;
+    for (char *entry = strtok_r(copy, "; \t\n", &save); entry && ok;
+         entry = strtok_r(NULL, "; \t\n", &save)) {
+        unsigned topics = PUBLISH_ALL;
+        unsigned long decimation = 1;
+        char *fields = strchr(entry, '/');
+        if (fields) {
+            *fields++ = '\0';
+            char *rate = strchr(fields, '/');
+            if (rate) {
+                *rate++ = '\0';
+                char *end;
+                decimation = strtoul(rate, &end, 10);
+                if (*end != '\0' || decimation == 0 || decimation > 1000000) ok = false;
+            }
+            if (ok && !parse_topics(fields, &topics)) ok = false;
+        }
+        if (!ok) fprintf(stderr, "publisher: bad subscriber '%s'\n", entry);
+        ok = ok && publisher_add(pub, entry, topics, (unsigned)decimation) >= 0;
+    }
+    free(copy);
+    return ok;
+}
+
+static bool reserve(Publisher *pub, size_t datagrams, size_t messages) {
+    if (datagrams > pub->iov_capacity) {
+        char *buf = realloc(pub->buf, datagrams * PUBLISH_MAX_DATAGRAM);
+        if (buf) pub->buf = buf;
+        struct iovec *iov = realloc(pub->iov, datagrams * sizeof(*iov));
+        if (iov) pub->iov = iov;
+        size_t *lens = realloc(pub->lens, datagrams * sizeof(*lens));
+        if (lens) pub->lens = lens;
+        if (!buf || !iov || !lens) return false;
+        pub->iov_capacity = datagrams;
+    }
+#ifdef __linux__
+    if (messages > pub->msgs_capacity) {
+        struct mmsghdr *msgs = realloc(pub->msgs, messages * sizeof(*msgs));
+        if (!msgs) return false;
+        pub->msgs = msgs;
+        pub->msgs_capacity = messages;
+    }
+#else
+    (void)messages;
+#endif
+    return true;
+}
+
+bool publisher_send(Publisher *pub, PublishTopic topic, double time,
+                    const void *records, size_t count) {
+    int t = topic_index(topic);
+    if (t < 0) return false;
+    uint64_t first = pub->sequence[t];
+    pub->sequence[t] += count;
+
+    // Decimation is decided before any work so skipped batches cost nothing.
+    int due = 0;
+    for (int i = 0; i < pub->count; i++) {
+        Subscriber *s = &pub->subs[i];
+        if (!(s->topics & topic)) continue;
+        if (s->countdown[t] == 0) {
+            pub->due[due++] = s;
+            s->countdown[t] = s->decimation - 1;
+        } else {
+            s->countdown[t]--;
+        }
+    }
+    if (due == 0 || count == 0) return true;
+
+    size_t size = publish_record_size(topic);
+    size_t per = topic == PUBLISH_TEXT ? 1 : (PUBLISH_MAX_DATAGRAM - sizeof(PublishHeader)) / size;
+    size_t datagrams = (count + per - 1) / per;
+    if (!reserve(pub, datagrams, datagrams * (size_t)due)) return false;
+
+    // Serialize once, whatever the number of subscribers.
+    const char *src = records;
+    for (size_t d = 0; d < datagrams && topic == PUBLISH_TEXT; d++) {
+        uint64_t word;
+        memcpy(&word, src + d * size, sizeof(word));
+        char *out = pub->buf + d * PUBLISH_MAX_DATAGRAM;
+        pub->lens[d] = (size_t)snprintf(out, PUBLISH_MAX_DATAGRAM, "%llu", (unsigned long long)word);
+        pub->iov[d] = (struct iovec){ out, pub->lens[d] };
+    }
+    for (size_t d = 0; d < datagrams && topic != PUBLISH_TEXT; d++) {
+        size_t n = count - d * per < per ? count - d * per : per;
+        char *out = pub->buf + d * PUBLISH_MAX_DATAGRAM;
+        PublishHeader h = { { 0 }, PUBLISH_VERSION, (uint8_t)topic, (uint16_t)n,
+                            first + d * per, time };
+        memcpy(h.magic, PUBLISH_MAGIC, 4);
+        memcpy(out, &h, sizeof(h));
+        memcpy(out + sizeof(h), src + d * per * size, n * size);
+        pub->lens[d] = sizeof(h) + n * size;
+        pub->iov[d] = (struct iovec){ out, pub->lens[d] };
+    }
+
+    bool ok = true;
+#ifdef __linux__
+    // Datagram-major order, so every subscriber gets the start of the batch
+    // before anyone gets its end.
+    size_t total = 0;
+    for (size_t d = 0; d < datagrams; d++) {
+        for (int i = 0; i < due; i++) {
+            struct mmsghdr *m = &pub->msgs[total++];
+            memset(m, 0, sizeof(*m));
+            m->msg_hdr.msg_name = (void *)&pub->due[i]->addr;
+            m->msg_hdr.msg_namelen = sizeof(pub->due[i]->addr);
+            m->msg_hdr.msg_iov = &pub->iov[d];
+            m->msg_hdr.msg_iovlen = 1;
+        }
+    }
+    for (size_t off = 0; off < total;) {
+        size_t n = total - off < SEND_CHUNK ? total - off : SEND_CHUNK;
+        int sent = sendmmsg(pub->sock, pub->msgs + off, (unsigned)n, 0);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            // One unreachable destination must not starve the others.
+            ok = false;
+            off++;
+            continue;
+        }
+        pub->datagrams += (uint64_t)sent;
+        off += (size_t)sent;
+    }
+#else
+    for (size_t d = 0; d < datagrams; d++) {
+        for (int i = 0; i < due; i++) {
+            ssize_t sent = sendto(pub->sock, pub->iov[d].iov_base, pub->lens[d], 0,
+                                  (const struct sockaddr *)&pub->due[i]->addr,
+                                  sizeof(pub->due[i]->addr));
+            if (sent < 0) ok = false;
+            else pub->datagrams++;
+        }
+    }
+#endif
+    return ok;
+}
+
+bool publish_decode(const void *data, size_t len, PublishHeader *header,
+                    const void **records) {
+    if (len < sizeof(*header)) return false;
+    memcpy(header, data, sizeof(*header));
+    size_t size = publish_record_size(header->topic);
+    if (memcmp(header->magic, PUBLISH_MAGIC, 4) != 0 || header->version != PUBLISH_VERSION ||
+        size == 0 || header->topic == PUBLISH_TEXT || len != sizeof(*header) + header->count * size) {
+        return false;
+    }
+    *records = (const char *)data + sizeof(*header);
+    return true;
+}
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <string.h>
+#include "render_layers.h"
+
+static SDL_Texture *create_target(SDL_Renderer *renderer, int width, int height) {
+    SDL_Texture *t = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                                       SDL_TEXTUREACCESS_TARGET, width, height);
+    if (!t) {
+        printf("SDL_CreateTexture Error: %s\n", SDL_GetError());
+    }
+    return t;
+}
+
+bool render_layers_init(RenderLayers *layers, SDL_Renderer *renderer, int width, int height) {
+    memset(layers, 0, sizeof(*layers));
+    layers->renderer = renderer;
+    layers->width = width;
+    layers->height = height;
+    if (!SDL_RenderTargetSupported(renderer)) {
+        return false;
+    }
+    layers->background = create_target(renderer, width, height);
+    if (!layers->background) {
+        return false;
+    }
+
+    // Scales the destination alpha by (1 - source alpha) and leaves the
+    // color alone, so filling the trail layer fades it towards transparent.
+    layers->fade_mode = SDL_ComposeCustomBlendMode(
+        SDL_BLENDFACTOR_ZERO, SDL_BLENDFACTOR_ONE, SDL_BLENDOPERATION_ADD,
+        SDL_BLENDFACTOR_ZERO, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+    layers->trail = create_target(renderer, width, height);
+    if (layers->trail && SDL_SetRenderDrawBlendMode(renderer, layers->fade_mode) == 0) {
+        SDL_SetTextureBlendMode(layers->trail, SDL_BLENDMODE_BLEND);
+        layers->trail_enabled = true;
+    } else {
+        printf("Trail layer unavailable, redrawing trails every frame\n");
+    }
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    render_layers_clear_trail(layers);
+    return true;
+}
+
+void render_layers_destroy(RenderLayers *layers) {
+    if (layers->background) SDL_DestroyTexture(layers->background);
+    if (layers->trail) SDL_DestroyTexture(layers->trail);
+    layers->background = NULL;
+    layers->trail = NULL;
+    layers->trail_enabled = false;
+}
+
+void render_layers_begin_background(RenderLayers *layers) {
+    SDL_SetRenderTarget(layers->renderer, layers->background);
+}
+
+void render_layers_end_background(RenderLayers *layers) {
+    SDL_SetRenderTarget(layers->renderer, NULL);
+}
+
+void render_layers_clear_trail(RenderLayers *layers) {
+    layers->pending_count = 0;
+    layers->pending_fades = 0;
+    layers->steps_since_fade = 0;
+    if (!layers->trail_enabled) return;
+    SDL_SetRenderTarget(layers->renderer, layers->trail);
+    SDL_SetRenderDrawColor(layers->renderer, 0, 0, 0, 0);
+    SDL_RenderClear(layers->renderer);
+    SDL_SetRenderTarget(layers->renderer, NULL);
+}
+
+// Applies queued fades first, then draws the segments queued since, fully
+// opaque. Segments pushed before a fade in the same batch are faded one step
+// less than they should be, which is not visible at 8 steps per fade.
+static void flush_trail(RenderLayers *layers) {
+    if (layers->pending_count == 0 && layers->pending_fades == 0) return;
+    SDL_Renderer *r = layers->renderer;
+    SDL_SetRenderTarget(r, layers->trail);
+    if (layers->pending_fades > 0) {
+        SDL_SetRenderDrawBlendMode(r, layers->fade_mode);
+        SDL_SetRenderDrawColor(r, 0, 0, 0, TRAIL_FADE_ALPHA);
+        for (int i = 0; i < layers->pending_fades; i++) {
+            SDL_RenderFillRect(r, NULL);
+        }
+        SDL_SetRenderDrawBlendMode(r, SDL_BLENDMODE_NONE);
+    }
+    for (int i = 0; i < layers->pending_count; i++) {
+        const TrailSegment *s = &layers->pending[i];
+        SDL_SetRenderDrawColor(r, s->r, s->g, s->b, 255);
+        SDL_RenderDrawLine(r, s->x0, s->y0, s->x1, s->y1);
+    }
+    SDL_SetRenderTarget(r, NULL);
+    layers->pending_count = 0;
+    layers->pending_fades = 0;
+}
+
+void render_layers_push_segment(RenderLayers *layers, const TrailSegment *segment) {
+    if (!layers->trail_enabled) return;
+    if (layers->pending_count == LAYER_MAX_PENDING_SEGMENTS) {
+        flush_trail(layers);
+    }
+    layers->pending[layers->pending_count++] = *segment;
+    if (++layers->steps_since_fade >= TRAIL_FADE_INTERVAL) {
+        layers->steps_since_fade = 0;
+        layers->pending_fades++;
+    }
+}
+
+void render_layers_composite(RenderLayers *layers) {
+    SDL_RenderCopy(layers->renderer, layers->background, NULL, NULL);
+    if (layers->trail_enabled) {
+        flush_trail(layers);
+        SDL_RenderCopy(layers->renderer, layers->trail, NULL, NULL);
+    }
+}
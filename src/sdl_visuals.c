@@ -3,15 +3,16 @@
 #include <stdio.h>
 #include <math.h>
 #include <stdint.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <unistd.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "sdl_visuals.h"
 #include "pendulum.h"
 #include "sha256.h"
+#include "deterministic.h"
+#include "shm_ring.h"
+#include "render_layers.h"
+#include "publisher.h"
 
 static SDL_Window *gWindow = NULL;
 static SDL_Renderer *gRenderer = NULL;
@@ -19,33 +20,82 @@ static const double PIX_PER_M = PIXELS_PER_METER;
 static bool simulation_running = false; 
 static bool is_dragging = false; 
 
-static int udp_sock = -1;
-static struct sockaddr_in udp_dest;
-static int udp_initialized = 0;
+static RenderLayers gLayers;
+static bool layers_ready = false;
+static bool use_layers = true;
+static bool layers_lost = false;   // renderer dropped the target textures
+
+// Subscribers come from PENDULUM_PUBLISH, see publisher_add_spec().
+#define DEFAULT_PUBLISH_SPEC "192.168.0.81:8080/text"
+// Physics steps per frame are bounded by the 0.25 s frame clamp.
+#define PUBLISH_BATCH 32
+
+static Publisher *publisher = NULL;
+static PendulumState state_batch[PUBLISH_BATCH];
+static PublishSample sample_batch[PUBLISH_BATCH];
+static int batch_count = 0;
+
+static ShmRing random_ring;
+static bool random_ring_ready = false;
+static bool random_ring_tried = false;   // another producer may own the name
 
 const int BOB_RADIUS = 10;
 const int PIVOT_X = SCREEN_WIDTH / 2;
 const int PIVOT_Y = SCREEN_HEIGHT / 3;
 
-void setup_udp_sender(const char* dest_ip, int dest_port) {
-    udp_sock = socket(AF_INET, SOCK_DGRAM, 0);
-    memset(&udp_dest, 0, sizeof(udp_dest));
-    udp_dest.sin_family = AF_INET;
-    udp_dest.sin_port = htons(dest_port);
-    inet_pton(AF_INET, dest_ip, &udp_dest.sin_addr);
-    udp_initialized = 1;
+// Average CPU time spent issuing render calls, reported every N frames.
+#define FRAME_STATS_INTERVAL 300
+
+static void setup_publisher(void) {
+    const char *spec = getenv("PENDULUM_PUBLISH");
+    publisher = publisher_create();
+    if (publisher && !publisher_add_spec(publisher, spec ? spec : DEFAULT_PUBLISH_SPEC)) {
+        publisher_destroy(publisher);
+        publisher = NULL;
+    }
+    if (publisher) {
+        printf("Publishing to %d subscriber%s\n", publisher_subscribers(publisher),
+               publisher_subscribers(publisher) == 1 ? "" : "s");
+    }
 }
 
-void send_random_number_udp(uint64_t randnum) {
-    if (!udp_initialized) return;
-    char msg[64];
-    snprintf(msg, sizeof(msg), "%llu", (unsigned long long)randnum);
-    ssize_t sent = sendto(udp_sock, msg, strlen(msg), 0, (struct sockaddr*)&udp_dest, sizeof(udp_dest));
-    if (sent < 0) {
-        perror("UDP sendto failed");
-    } else {
-        printf("[UDP] Sent %s (%zd bytes)\n", msg, sent);
+static void pendulum_positions(const Pendulum *p, PublishSample *s) {
+#ifdef PENDULUM_DETERMINISTIC
+    // The hash sees the last bit of the product, so use the same
+    // reproducible trig as the integrator.
+    s->x1 = p->l1 * det_sin(p->theta1);
+    s->y1 = -p->l1 * det_cos(p->theta1);
+    s->x2 = s->x1 + p->l2 * det_sin(p->theta2);
+    s->y2 = s->y1 - p->l2 * det_cos(p->theta2);
+#else
+    s->x1 = p->l1 * sin(p->theta1);
+    s->y1 = -p->l1 * cos(p->theta1);
+    s->x2 = s->x1 + p->l2 * sin(p->theta2);
+    s->y2 = s->y1 - p->l2 * cos(p->theta2);
+#endif
+}
+
+// Sends the steps collected this frame as one batch per topic.
+static void publish_batch(double sim_time) {
+    if (!publisher || batch_count == 0) return;
+    if (publisher_wants(publisher, PUBLISH_STATE) &&
+        !publisher_send(publisher, PUBLISH_STATE, sim_time, state_batch, (size_t)batch_count)) {
+        perror("publish state");
+    }
+    if (publisher_wants(publisher, PUBLISH_SAMPLES) &&
+        !publisher_send(publisher, PUBLISH_SAMPLES, sim_time, sample_batch, (size_t)batch_count)) {
+        perror("publish samples");
+    }
+    batch_count = 0;
+}
+
+static void collect_step(const Pendulum *p, double sim_time) {
+    if (!publisher) return;
+    state_batch[batch_count] = (PendulumState){ p->theta1, p->theta2, p->omega1, p->omega2 };
+    if (publisher_wants(publisher, PUBLISH_SAMPLES)) {
+        pendulum_positions(p, &sample_batch[batch_count]);
     }
+    if (++batch_count == PUBLISH_BATCH) publish_batch(sim_time);
 }
 
 static void draw_grid() {
@@ -91,7 +141,7 @@ static bool init_sdl() {
         return false;
     }
 
-    gRenderer = SDL_CreateRenderer(gWindow, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    gRenderer = SDL_CreateRenderer(gWindow, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC | SDL_RENDERER_TARGETTEXTURE);
     if (!gRenderer) {
         printf("SDL_CreateRenderer Error: %s\n", SDL_GetError());
         return false;
@@ -101,16 +151,37 @@ static bool init_sdl() {
 }
 
 static void close_sdl() {
+    if (layers_ready) render_layers_destroy(&gLayers);
+    layers_ready = false;
     if (gRenderer) SDL_DestroyRenderer(gRenderer);
     if (gWindow) SDL_DestroyWindow(gWindow);
     SDL_Quit();
 }
 
-static void render_pendulum(const Pendulum *p) {
-    int x1 = PIVOT_X + (int)(p->l1 * sin(p->theta1) * PIX_PER_M);
-    int y1 = PIVOT_Y + (int)(p->l1 * cos(p->theta1) * PIX_PER_M);
-    int x2 = x1 + (int)(p->l2 * sin(p->theta2) * PIX_PER_M);
-    int y2 = y1 + (int)(p->l2 * cos(p->theta2) * PIX_PER_M);
+static void draw_background() {
+    SDL_SetRenderDrawColor(gRenderer, 30, 30, 40, 255); 
+    SDL_RenderClear(gRenderer);
+    draw_grid();
+}
+
+// The grid never changes, so the layered path renders it once.
+static void build_background_layer() {
+    render_layers_begin_background(&gLayers);
+    draw_background();
+    render_layers_end_background(&gLayers);
+}
+
+static void setup_layers() {
+    layers_ready = render_layers_init(&gLayers, gRenderer, SCREEN_WIDTH, SCREEN_HEIGHT);
+    if (layers_ready) {
+        build_background_layer();
+    } else {
+        printf("Render targets unsupported, drawing every layer each frame\n");
+    }
+}
+
+// Legacy trail: redraws every stored segment with a linear fade.
+static void render_trail(const Pendulum *p) {
     int start = p->trail_full ? 0 : p->trail_index;
     int end = p->trail_full ? TRAIL_LENGTH : p->trail_index;
     int length = p->trail_full ? TRAIL_LENGTH : p->trail_index;
@@ -126,6 +197,13 @@ static void render_pendulum(const Pendulum *p) {
                            p->trail_x[current_idx], p->trail_y[current_idx],
                            p->trail_x[next_idx], p->trail_y[next_idx]);
     }
+}
+
+static void render_pendulum(const Pendulum *p) {
+    int x1 = PIVOT_X + (int)(p->l1 * sin(p->theta1) * PIX_PER_M);
+    int y1 = PIVOT_Y + (int)(p->l1 * cos(p->theta1) * PIX_PER_M);
+    int x2 = x1 + (int)(p->l2 * sin(p->theta2) * PIX_PER_M);
+    int y2 = y1 + (int)(p->l2 * cos(p->theta2) * PIX_PER_M);
     SDL_SetRenderDrawColor(gRenderer, 150, 150, 150, 255);
     SDL_RenderDrawLine(gRenderer, PIVOT_X, PIVOT_Y, x1, y1);
     SDL_RenderDrawLine(gRenderer, x1, y1, x2, y2);
@@ -154,6 +232,11 @@ static bool handle_input(Pendulum *p) {
             return false;
         }
 
+        // Target texture contents (or the textures themselves) are gone.
+        if (event.type == SDL_RENDER_TARGETS_RESET || event.type == SDL_RENDER_DEVICE_RESET) {
+            layers_lost = true;
+        }
+
         if (event.type == SDL_KEYDOWN) {
             if (event.key.keysym.sym == SDLK_r) {
                 init_pendulum(p, p->m1, p->m2, p->l1, p->l2, p->g, M_PI / 2.0, M_PI / 2.0, p->color_r, p->color_g, p->color_b);
@@ -164,6 +247,9 @@ static bool handle_input(Pendulum *p) {
                 if (simulation_running) {
                     printf("Starting state: Omega1=%.2f, Omega2=%.2f\n", p->omega1, p->omega2);
                 }
+            } else if (event.key.keysym.sym == SDLK_l) {
+                use_layers = !use_layers && layers_ready;
+                printf("--- Rendering: %s ---\n", use_layers ? "layered" : "full redraw");
             } else if (event.key.keysym.sym == SDLK_w) p->omega1 += VEL_STEP;
             else if (event.key.keysym.sym == SDLK_s) p->omega1 -= VEL_STEP;
             else if (event.key.keysym.sym == SDLK_a) p->omega2 -= VEL_STEP;
@@ -211,6 +297,15 @@ void run_simulation(Pendulum *p) {
     printf("Position: Theta1=%.2f, Theta2=%.2f\n", p->theta1, p->theta2);
     printf("Velocity: Omega1=%.2f, Omega2=%.2f\n", p->omega1, p->omega2);
 
+    setup_layers();
+    use_layers = layers_ready;
+    setup_publisher();
+    bool trail_layer_dirty = false;
+    int frames = 0;
+    double render_seconds = 0.0;
+    double present_seconds = 0.0;
+    const double perf_freq = (double)SDL_GetPerformanceFrequency();
+
     const double PHYS_STEP = 0.01; 
     bool running = true;
     Uint32 last_time = SDL_GetTicks();
@@ -228,16 +323,43 @@ void run_simulation(Pendulum *p) {
         running = handle_input(p); 
         if (!running) break;
 
+        // Rebuild the layers from scratch; the trail layer restarts empty.
+        if (layers_lost) {
+            layers_lost = false;
+            if (layers_ready) {
+                render_layers_destroy(&gLayers);
+                setup_layers();
+                use_layers = use_layers && layers_ready;
+                trail_layer_dirty = false;
+            }
+        }
+
+        // Reset, drag and restart all empty the trail buffer.
+        if (trail_layer_dirty && p->trail_index == 0 && !p->trail_full) {
+            render_layers_clear_trail(&gLayers);
+            trail_layer_dirty = false;
+        }
+
         if (simulation_running) {
             while (accumulator >= PHYS_STEP) {
                 update_pendulum(p, PHYS_STEP, PIX_PER_M, SCREEN_WIDTH, SCREEN_HEIGHT);
+                if (layers_ready && (p->trail_index >= 2 || p->trail_full)) {
+                    int cur = (p->trail_index + TRAIL_LENGTH - 1) % TRAIL_LENGTH;
+                    int prev = (p->trail_index + TRAIL_LENGTH - 2) % TRAIL_LENGTH;
+                    TrailSegment seg = {
+                        p->trail_x[prev], p->trail_y[prev], p->trail_x[cur], p->trail_y[cur],
+                        p->color_r, p->color_g, p->color_b
+                    };
+                    render_layers_push_segment(&gLayers, &seg);
+                    trail_layer_dirty = true;
+                }
                 accumulator -= PHYS_STEP;
                 sim_time += PHYS_STEP;
+                collect_step(p, sim_time);
                 if (sim_time >= next_log_time) {
-                    double x1 = p->l1 * sin(p->theta1);
-                    double y1 = -p->l1 * cos(p->theta1);
-                    double x2 = x1 + p->l2 * sin(p->theta2);
-                    double y2 = y1 - p->l2 * cos(p->theta2);
+                    PublishSample pos;
+                    pendulum_positions(p, &pos);
+                    double x1 = pos.x1, y1 = pos.y1, x2 = pos.x2, y2 = pos.y2;
                     printf("[t=%.2fs] Mass1: (%.3f, %.3f)  Mass2: (%.3f, %.3f)", sim_time, x1, y1, x2, y2);
 
                     double product = x1 * y1 * x2 * y2;
@@ -254,25 +376,62 @@ void run_simulation(Pendulum *p) {
                     for (int i = 0; i < 8; i++) randnum = (randnum << 8) | hash[i];
                     printf(" | Random: %llu\n", (unsigned long long)randnum);
 
-                    if (!udp_initialized) {
-                        setup_udp_sender("192.168.0.81", 8080);
+                    if (publisher && publisher_wants(publisher, PUBLISH_RANDOM) &&
+                        !publisher_send(publisher, PUBLISH_RANDOM, sim_time, &randnum, 1)) {
+                        perror("publish random");
+                    }
+                    if (publisher && publisher_wants(publisher, PUBLISH_TEXT) &&
+                        !publisher_send(publisher, PUBLISH_TEXT, sim_time, &randnum, 1)) {
+                        perror("publish text");
                     }
 
-                    send_random_number_udp(randnum);
+                    if (!random_ring_tried) {
+                        random_ring_tried = true;
+                        random_ring_ready = shm_ring_create(&random_ring, SHM_RING_DEFAULT_NAME,
+                                                            SHM_RING_DEFAULT_CAPACITY);
+                    }
+                    if (random_ring_ready) {
+                        shm_ring_publish(&random_ring, randnum);
+                    }
 
                     next_log_time += 2.0;
                 }
             }
+            publish_batch(sim_time);
+        }
+
+        Uint64 render_start = SDL_GetPerformanceCounter();
+        if (use_layers) {
+            render_layers_composite(&gLayers);
+            if (!gLayers.trail_enabled) render_trail(p);
+            render_pendulum(p);
+        } else {
+            draw_background();
+            render_trail(p);
+            render_pendulum(p);
         }
+        Uint64 present_start = SDL_GetPerformanceCounter();
+        render_seconds += (present_start - render_start) / perf_freq;
 
-        SDL_SetRenderDrawColor(gRenderer, 30, 30, 40, 255); 
-        SDL_RenderClear(gRenderer);
-        
-        draw_grid(); 
-        render_pendulum(p);
-        
+        // Reported separately: batched draws are flushed here, and with vsync
+        // it also includes the wait for the display.
         SDL_RenderPresent(gRenderer);
+        present_seconds += (SDL_GetPerformanceCounter() - present_start) / perf_freq;
+        if (++frames == FRAME_STATS_INTERVAL) {
+            printf("[render] %s: %.3f ms issuing draws, %.3f ms in present per frame\n",
+                   use_layers ? "layered" : "full redraw", 1000.0 * render_seconds / frames,
+                   1000.0 * present_seconds / frames);
+            frames = 0;
+            render_seconds = 0.0;
+            present_seconds = 0.0;
+        }
     }
 
+    if (random_ring_ready) {
+        shm_ring_close(&random_ring);
+        random_ring_ready = false;
+    }
+    publisher_destroy(publisher);
+    publisher = NULL;
     close_sdl();
 }
\ No newline at end of file
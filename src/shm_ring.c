@@ -0,0 +1,278 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#include "shm_ring.h"
+
+#define SHM_RING_MAGIC 0x50524e47u     // "PRNG"
+#define SHM_RING_VERSION 1u
+#define CACHE_LINE 64
+// Consumers map the ring read-write (shm_ring_wait() counts itself in the
+// header), so they need the producer's user or group; see shm_ring.h.
+#define SHM_RING_MODE 0660
+
+// Lives at the start of the shared mapping. The producer-written counters sit
+// on their own cache lines so readers polling head do not false-share with
+// the waiter count they bump.
+struct ShmRingHeader {
+    _Atomic uint32_t magic;        // written last, once the header is valid
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t slot_size;
+    _Atomic int32_t owner_pid;     // producer process, to tell live rings from stale ones
+    _Alignas(CACHE_LINE) _Atomic uint64_t head;        // next sequence to publish
+    _Alignas(CACHE_LINE) _Atomic uint32_t futex_word;  // bumped on publish when waited on
+    _Atomic uint32_t waiters;
+};
+
+// seq is 0 while the slot is being rewritten, otherwise 1 + the sequence
+// number of the word in value (a per-slot seqlock).
+struct ShmRingSlot {
+    _Atomic uint64_t seq;
+    _Atomic uint64_t value;
+};
+
+static uint32_t round_up_pow2(uint32_t v) {
+    uint32_t p = 1;
+    while (p < v && p < (1u << 31)) p <<= 1;
+    return p;
+}
+
+static bool map_ring(ShmRing *ring, size_t size) {
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, 0);
+    if (base == MAP_FAILED) {
+        perror("shm_ring mmap");
+        return false;
+    }
+    ring->map_size = size;
+    ring->header = base;
+    ring->slots = (ShmRingSlot *)((char *)base + sizeof(ShmRingHeader));
+    return true;
+}
+
+// Pid of the live producer of an existing ring, or 0 if it has exited or
+// the object was never fully initialized.
+static int32_t ring_owner(const char *name) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return 0;
+    struct stat st;
+    int32_t pid = 0;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(ShmRingHeader)) {
+        ShmRingHeader *h = mmap(NULL, sizeof(ShmRingHeader), PROT_READ, MAP_SHARED, fd, 0);
+        if (h != MAP_FAILED) {
+            if (atomic_load_explicit(&h->magic, memory_order_acquire) == SHM_RING_MAGIC) {
+                pid = atomic_load(&h->owner_pid);
+            }
+            munmap(h, sizeof(ShmRingHeader));
+        }
+    }
+    close(fd);
+    // EPERM still means the process exists.
+    if (pid > 0 && kill(pid, 0) != 0 && errno == ESRCH) pid = 0;
+    return pid;
+}
+
+bool shm_ring_create(ShmRing *ring, const char *name, uint32_t capacity) {
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+    capacity = round_up_pow2(capacity ? capacity : SHM_RING_DEFAULT_CAPACITY);
+    snprintf(ring->name, sizeof(ring->name), "%s", name);
+
+    // A stale object from a crashed producer is replaced, not reused; one
+    // whose producer is still running is left alone.
+    ring->fd = shm_open(ring->name, O_CREAT | O_EXCL | O_RDWR, SHM_RING_MODE);
+    if (ring->fd < 0 && errno == EEXIST) {
+        int32_t pid = ring_owner(ring->name);
+        if (pid > 0) {
+            fprintf(stderr, "shm_ring: %s is in use by process %d\n", ring->name, (int)pid);
+            errno = EEXIST;
+            return false;
+        }
+        shm_unlink(ring->name);
+        ring->fd = shm_open(ring->name, O_CREAT | O_EXCL | O_RDWR, SHM_RING_MODE);
+    }
+    if (ring->fd < 0) {
+        perror("shm_ring shm_open");
+        return false;
+    }
+    // The creation mode is filtered by the umask; group write is required.
+    if (fchmod(ring->fd, SHM_RING_MODE) < 0) {
+        perror("shm_ring fchmod");
+        close(ring->fd);
+        shm_unlink(ring->name);
+        return false;
+    }
+    size_t size = sizeof(ShmRingHeader) + (size_t)capacity * sizeof(ShmRingSlot);
+    if (ftruncate(ring->fd, (off_t)size) < 0) {
+        perror("shm_ring ftruncate");
+        close(ring->fd);
+        shm_unlink(ring->name);
+        return false;
+    }
+    if (!map_ring(ring, size)) {
+        close(ring->fd);
+        shm_unlink(ring->name);
+        return false;
+    }
+    ring->owner = true;
+    ring->mask = capacity - 1;
+
+    // ftruncate zero-fills, so every slot starts out empty (seq == 0).
+    ShmRingHeader *h = ring->header;
+    h->capacity = capacity;
+    h->slot_size = sizeof(ShmRingSlot);
+    h->version = SHM_RING_VERSION;
+    atomic_store_explicit(&h->owner_pid, (int32_t)getpid(), memory_order_relaxed);
+    atomic_store_explicit(&h->head, 0, memory_order_relaxed);
+    atomic_store_explicit(&h->magic, SHM_RING_MAGIC, memory_order_release);
+    return true;
+}
+
+bool shm_ring_open(ShmRing *ring, const char *name) {
+    memset(ring, 0, sizeof(*ring));
+    snprintf(ring->name, sizeof(ring->name), "%s", name);
+    ring->fd = shm_open(ring->name, O_RDWR, 0);
+    if (ring->fd < 0) {
+        perror("shm_ring shm_open");
+        return false;
+    }
+    struct stat st;
+    if (fstat(ring->fd, &st) < 0 || (size_t)st.st_size < sizeof(ShmRingHeader) ||
+        !map_ring(ring, (size_t)st.st_size)) {
+        fprintf(stderr, "shm_ring: %s is not a ring\n", ring->name);
+        close(ring->fd);
+        return false;
+    }
+    ShmRingHeader *h = ring->header;
+    uint32_t magic = atomic_load_explicit(&h->magic, memory_order_acquire);
+    if (magic != SHM_RING_MAGIC || h->version != SHM_RING_VERSION ||
+        h->slot_size != sizeof(ShmRingSlot) ||
+        h->capacity == 0 || (h->capacity & (h->capacity - 1)) != 0 ||
+        sizeof(ShmRingHeader) + (size_t)h->capacity * sizeof(ShmRingSlot) > ring->map_size) {
+        fprintf(stderr, "shm_ring: %s has an incompatible layout\n", ring->name);
+        shm_ring_close(ring);
+        return false;
+    }
+    ring->mask = h->capacity - 1;
+    return true;
+}
+
+void shm_ring_close(ShmRing *ring) {
+    if (ring->header) munmap(ring->header, ring->map_size);
+    if (ring->fd >= 0) close(ring->fd);
+    if (ring->owner) shm_unlink(ring->name);
+    ring->header = NULL;
+    ring->slots = NULL;
+    ring->fd = -1;
+    ring->owner = false;
+}
+
+static void write_slot(ShmRing *ring, uint64_t seq, uint64_t word) {
+    ShmRingSlot *slot = &ring->slots[seq & ring->mask];
+    atomic_store_explicit(&slot->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&slot->value, word, memory_order_relaxed);
+    atomic_store_explicit(&slot->seq, seq + 1, memory_order_release);
+}
+
+static void wake_waiters(ShmRing *ring) {
+    ShmRingHeader *h = ring->header;
+    if (atomic_load(&h->waiters) == 0) return;
+    atomic_fetch_add(&h->futex_word, 1);
+#ifdef __linux__
+    syscall(SYS_futex, &h->futex_word, FUTEX_WAKE, INT32_MAX, NULL, NULL, 0);
+#endif
+}
+
+void shm_ring_publish(ShmRing *ring, uint64_t word) {
+    shm_ring_publish_batch(ring, &word, 1);
+}
+
+void shm_ring_publish_batch(ShmRing *ring, const uint64_t *words, size_t count) {
+    ShmRingHeader *h = ring->header;
+    uint64_t head = atomic_load_explicit(&h->head, memory_order_relaxed);
+    for (size_t i = 0; i < count; i++) {
+        write_slot(ring, head + i, words[i]);
+    }
+    atomic_store(&h->head, head + count);
+    wake_waiters(ring);
+}
+
+uint64_t shm_ring_head(const ShmRing *ring) {
+    return atomic_load_explicit(&ring->header->head, memory_order_acquire);
+}
+
+void shm_ring_reader_init(ShmRingReader *reader, const ShmRing *ring, bool from_oldest) {
+    uint64_t head = shm_ring_head(ring);
+    uint64_t capacity = ring->mask + 1;
+    reader->ring = ring;
+    reader->lost = 0;
+    if (!from_oldest) {
+        reader->next_seq = head;
+    } else {
+        reader->next_seq = head > capacity ? head - capacity : 0;
+    }
+}
+
+size_t shm_ring_read(ShmRingReader *reader, uint64_t *out, size_t max, uint64_t *first_seq) {
+    const ShmRing *ring = reader->ring;
+    uint64_t capacity = ring->mask + 1;
+    uint64_t head = shm_ring_head(ring);
+
+    if (head - reader->next_seq > capacity) {
+        uint64_t oldest = head - capacity;
+        reader->lost += oldest - reader->next_seq;
+        reader->next_seq = oldest;
+    }
+    if (first_seq) *first_seq = reader->next_seq;
+
+    size_t n = 0;
+    while (n < max && reader->next_seq < head) {
+        uint64_t seq = reader->next_seq;
+        ShmRingSlot *slot = &ring->slots[seq & ring->mask];
+        uint64_t before = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        uint64_t value = atomic_load_explicit(&slot->value, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        uint64_t after = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+        if (before != seq + 1 || after != seq + 1) {
+            // Overwritten while we were behind: stop here so the words
+            // returned stay contiguous; the next call skips the gap.
+            break;
+        }
+        out[n++] = value;
+        reader->next_seq++;
+    }
+    return n;
+}
+
+bool shm_ring_wait(ShmRingReader *reader, int timeout_ms) {
+    ShmRingHeader *h = reader->ring->header;
+    if (shm_ring_head(reader->ring) > reader->next_seq) return true;
+
+    atomic_fetch_add(&h->waiters, 1);
+    uint32_t word = atomic_load(&h->futex_word);
+    bool ready = shm_ring_head(reader->ring) > reader->next_seq;
+    if (!ready) {
+#ifdef __linux__
+        struct timespec ts = { timeout_ms / 1000, (long)(timeout_ms % 1000) * 1000000L };
+        syscall(SYS_futex, &h->futex_word, FUTEX_WAIT, word, timeout_ms < 0 ? NULL : &ts, NULL, 0);
+#else
+        (void)word;
+        struct timespec ts = { 0, 1000000L };
+        nanosleep(&ts, NULL);
+#endif
+        ready = shm_ring_head(reader->ring) > reader->next_seq;
+    }
+    atomic_fetch_sub(&h->waiters, 1);
+    return ready;
+}
@@ -0,0 +1,485 @@
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "trajectory.h"
+#include "async_io.h"
+
+// States are read and written as TRAJECTORY_CHANNELS consecutive doubles.
+_Static_assert(sizeof(PendulumState) == TRAJECTORY_CHANNELS * sizeof(double),
+               "PendulumState must be four packed doubles");
+
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+    uint64_t acc;
+    unsigned bits;
+} BitWriter;
+
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    size_t pos;
+    uint64_t acc;
+    unsigned bits;
+} BitReader;
+
+struct TrajectoryWriter {
+    TrajectoryHeader header;
+    double limit[TRAJECTORY_CHANNELS];  // largest quantizable |x| per lossy channel
+    int fd;
+    AsyncIo *io;
+    int slot;
+    double *block;          // [pendulum][channel][sample] for the current block
+    uint32_t filled;
+    uint64_t samples;
+    uint64_t offset;
+    BitWriter out;
+    TrajectoryIndexEntry *index;
+    size_t index_count;
+    size_t index_capacity;
+};
+
+struct TrajectoryReader {
+    TrajectoryHeader header;
+    TrajectoryTrailer trailer;
+    int fd;
+    TrajectoryIndexEntry *index;
+    uint8_t *encoded;
+    size_t encoded_capacity;
+    PendulumState *decoded;     // [sample][pendulum] of the cached block
+    int64_t cached_block;
+};
+
+static uint64_t double_bits(double x) {
+    uint64_t u;
+    memcpy(&u, &x, sizeof(u));
+    return u;
+}
+
+static double bits_double(uint64_t u) {
+    double x;
+    memcpy(&x, &u, sizeof(x));
+    return x;
+}
+
+static uint64_t zigzag(uint64_t v) {
+    return (v << 1) ^ (uint64_t)((int64_t)v >> 63);
+}
+
+static uint64_t unzigzag(uint64_t z) {
+    return (z >> 1) ^ (0 - (z & 1));
+}
+
+// Room for the worst case is reserved per series, so puts never check capacity.
+static bool reserve_bits(BitWriter *b, size_t bytes) {
+    if (b->size + bytes <= b->capacity) return true;
+    size_t capacity = b->capacity ? b->capacity : 4096;
+    while (capacity < b->size + bytes) capacity *= 2;
+    uint8_t *data = realloc(b->data, capacity);
+    if (!data) return false;
+    b->data = data;
+    b->capacity = capacity;
+    return true;
+}
+
+static inline void put32(BitWriter *b, uint32_t value, unsigned n) {
+    b->acc = (b->acc << n) | value;
+    b->bits += n;
+    while (b->bits >= 8) {
+        b->bits -= 8;
+        b->data[b->size++] = (uint8_t)(b->acc >> b->bits);
+    }
+}
+
+static inline void put_bits(BitWriter *b, uint64_t value, unsigned n) {
+    if (n > 32) {
+        put32(b, (uint32_t)(value >> 32), n - 32);
+        n = 32;
+    }
+    put32(b, (uint32_t)value & (uint32_t)((1ull << n) - 1), n);
+}
+
+static void align_bits(BitWriter *b) {
+    if (b->bits) put32(b, 0, 8 - b->bits);
+    b->acc = 0;
+}
+
+static inline uint32_t get32(BitReader *r, unsigned n) {
+    while (r->bits < n) {
+        r->acc = (r->acc << 8) | (r->pos < r->size ? r->data[r->pos] : 0);
+        r->pos++;
+        r->bits += 8;
+    }
+    r->bits -= n;
+    return (uint32_t)(r->acc >> r->bits) & (uint32_t)((1ull << n) - 1);
+}
+
+static inline uint64_t get_bits(BitReader *r, unsigned n) {
+    if (n <= 32) return get32(r, n);
+    uint64_t hi = get32(r, n - 32);
+    return (hi << 32) | get32(r, 32);
+}
+
+// Predicts from the two previous values; exact in both directions because
+// the decoder sees the same (lossless) history.
+static inline double predict(const double *x, size_t stride, uint32_t i) {
+    if (i == 0) return 0.0;
+    if (i == 1) return x[0];
+    return 2.0 * x[(i - 1) * stride] - x[(i - 2) * stride];
+}
+
+static void encode_xor(BitWriter *b, const double *x, uint32_t n) {
+    unsigned lead = 64, trail = 0;      // no window yet
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t r = double_bits(x[i]) ^ double_bits(predict(x, 1, i));
+        if (r == 0) {
+            put32(b, 0, 1);
+            continue;
+        }
+        unsigned l = (unsigned)__builtin_clzll(r);
+        unsigned t = (unsigned)__builtin_ctzll(r);
+        if (l >= lead && t >= trail) {
+            put32(b, 2, 2);
+            put_bits(b, r >> trail, 64 - lead - trail);
+        } else {
+            unsigned len = 64 - l - t;
+            put32(b, 3, 2);
+            put32(b, l, 6);
+            put32(b, len - 1, 6);
+            put_bits(b, r >> t, len);
+            lead = l;
+            trail = t;
+        }
+    }
+}
+
+static bool decode_xor(BitReader *rd, double *x, size_t stride, uint32_t n) {
+    unsigned lead = 64, trail = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t r = 0;
+        if (get32(rd, 1)) {
+            if (get32(rd, 1) == 0) {
+                if (lead == 64) return false;
+                r = get_bits(rd, 64 - lead - trail) << trail;
+            } else {
+                lead = get32(rd, 6);
+                unsigned len = get32(rd, 6) + 1;
+                if (lead + len > 64) return false;
+                trail = 64 - lead - len;
+                r = get_bits(rd, len) << trail;
+            }
+        }
+        x[i * stride] = bits_double(double_bits(predict(x, stride, i)) ^ r);
+    }
+    return true;
+}
+
+// Delta-of-delta buckets: 0 | 10+7 | 110+12 | 1110+20 | 11110+32 | 11111+64 bits.
+static void put_dod(BitWriter *b, uint64_t dod) {
+    uint64_t z = zigzag(dod);
+    if (z == 0) put32(b, 0, 1);
+    else if (z < (1u << 7)) put32(b, (2u << 7) | (uint32_t)z, 9);
+    else if (z < (1u << 12)) put32(b, (6u << 12) | (uint32_t)z, 15);
+    else if (z < (1u << 20)) put32(b, (14u << 20) | (uint32_t)z, 24);
+    else if (z < (1ull << 32)) {
+        put32(b, 30, 5);
+        put32(b, (uint32_t)z, 32);
+    } else {
+        put32(b, 31, 5);
+        put_bits(b, z, 64);
+    }
+}
+
+static uint64_t get_dod(BitReader *r) {
+    uint64_t z;
+    if (get32(r, 1) == 0) z = 0;
+    else if (get32(r, 1) == 0) z = get32(r, 7);
+    else if (get32(r, 1) == 0) z = get32(r, 12);
+    else if (get32(r, 1) == 0) z = get32(r, 20);
+    else if (get32(r, 1) == 0) z = get32(r, 32);
+    else z = get_bits(r, 64);
+    return unzigzag(z);
+}
+
+// Unsigned arithmetic so that wrap-around is defined and reversible.
+static void encode_quantized(BitWriter *b, const double *x, uint32_t n, double q) {
+    uint64_t prev = 0, delta = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t k = (uint64_t)llround(x[i] / q);
+        if (i == 0) put_bits(b, k, 64);
+        else put_dod(b, (k - prev) - delta);
+        if (i > 0) delta = k - prev;
+        prev = k;
+    }
+}
+
+static void decode_quantized(BitReader *r, double *x, size_t stride, uint32_t n, double q) {
+    uint64_t prev = 0, delta = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t k;
+        if (i == 0) {
+            k = get_bits(r, 64);
+        } else {
+            delta += get_dod(r);
+            k = prev + delta;
+        }
+        prev = k;
+        x[i * stride] = (double)(int64_t)k * q;
+    }
+}
+
+void trajectory_default_options(TrajectoryOptions *opts) {
+    for (int c = 0; c < TRAJECTORY_CHANNELS; c++) opts->quantum[c] = 0.0;
+    opts->block_samples = 256;
+}
+
+TrajectoryWriter *trajectory_writer_open(const char *path, uint32_t pendulums,
+                                         double t0, double dt, const TrajectoryOptions *opts) {
+    if (pendulums == 0 || opts->block_samples < 2 || !(dt > 0.0) ||
+        opts->block_samples > SIZE_MAX / sizeof(double) / TRAJECTORY_CHANNELS / pendulums) {
+        return NULL;
+    }
+    TrajectoryWriter *w = calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    memcpy(w->header.magic, TRAJECTORY_MAGIC, 4);
+    w->header.version = TRAJECTORY_VERSION;
+    w->header.pendulums = pendulums;
+    w->header.block_samples = opts->block_samples;
+    w->header.t0 = t0;
+    w->header.dt = dt;
+    for (int c = 0; c < TRAJECTORY_CHANNELS; c++) {
+        double q = opts->quantum[c] > 0.0 ? opts->quantum[c] : 0.0;
+        w->header.quantum[c] = q;
+        w->limit[c] = ldexp(q, 62);
+    }
+
+    w->block = malloc((size_t)pendulums * TRAJECTORY_CHANNELS * opts->block_samples * sizeof(double));
+    w->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    AsyncIoOptions io_opts;
+    async_io_default_options(&io_opts);
+    w->io = w->fd >= 0 ? async_io_create(&io_opts) : NULL;
+    w->slot = w->io ? async_io_add_file(w->io, w->fd) : -1;
+    if (!w->block || w->slot < 0 ||
+        !async_io_write_copy(w->io, w->slot, &w->header, sizeof(w->header))) {
+        async_io_destroy(w->io);
+        if (w->fd >= 0) close(w->fd);
+        free(w->block);
+        free(w);
+        return NULL;
+    }
+    w->offset = sizeof(w->header);
+    return w;
+}
+
+static bool write_block(TrajectoryWriter *w) {
+    uint32_t n = w->filled;
+    uint32_t stride = w->header.block_samples;
+    size_t series = (size_t)w->header.pendulums * TRAJECTORY_CHANNELS;
+    w->out.size = 0;
+    w->out.bits = 0;
+    w->out.acc = 0;
+    // Worst case is 78 bits per value.
+    if (!reserve_bits(&w->out, series * (n * 10ull + 8))) return false;
+    for (size_t s = 0; s < series; s++) {
+        const double *x = w->block + s * stride;
+        double q = w->header.quantum[s % TRAJECTORY_CHANNELS];
+        if (q > 0.0) encode_quantized(&w->out, x, n, q);
+        else encode_xor(&w->out, x, n);
+    }
+    align_bits(&w->out);
+
+    if (w->index_count == w->index_capacity) {
+        size_t capacity = w->index_capacity ? 2 * w->index_capacity : 64;
+        TrajectoryIndexEntry *index = realloc(w->index, capacity * sizeof(*index));
+        if (!index) return false;
+        w->index = index;
+        w->index_capacity = capacity;
+    }
+    w->index[w->index_count++] = (TrajectoryIndexEntry){ w->offset, (uint32_t)w->out.size, n };
+    w->offset += w->out.size;
+    w->filled = 0;
+    return async_io_write_copy(w->io, w->slot, w->out.data, w->out.size);
+}
+
+static bool store_value(TrajectoryWriter *w, uint32_t p, int c, double x) {
+    double q = w->header.quantum[c];
+    if (q > 0.0 && !(fabs(x) < w->limit[c])) return false;
+    size_t series = (size_t)p * TRAJECTORY_CHANNELS + (size_t)c;
+    w->block[series * w->header.block_samples + w->filled] = x;
+    return true;
+}
+
+static bool finish_sample(TrajectoryWriter *w) {
+    w->samples++;
+    if (++w->filled < w->header.block_samples) return true;
+    return write_block(w);
+}
+
+bool trajectory_writer_append(TrajectoryWriter *w, const PendulumState *states) {
+    for (uint32_t p = 0; p < w->header.pendulums; p++) {
+        if (!store_value(w, p, 0, states[p].theta1) || !store_value(w, p, 1, states[p].theta2) ||
+            !store_value(w, p, 2, states[p].omega1) || !store_value(w, p, 3, states[p].omega2)) {
+            return false;
+        }
+    }
+    return finish_sample(w);
+}
+
+bool trajectory_writer_append_soa(TrajectoryWriter *w,
+                                  const double *theta1, const double *theta2,
+                                  const double *omega1, const double *omega2) {
+    for (uint32_t p = 0; p < w->header.pendulums; p++) {
+        if (!store_value(w, p, 0, theta1[p]) || !store_value(w, p, 1, theta2[p]) ||
+            !store_value(w, p, 2, omega1[p]) || !store_value(w, p, 3, omega2[p])) {
+            return false;
+        }
+    }
+    return finish_sample(w);
+}
+
+uint64_t trajectory_writer_bytes(const TrajectoryWriter *w) {
+    return w->offset;
+}
+
+bool trajectory_writer_close(TrajectoryWriter *w) {
+    if (!w) return false;
+    bool ok = w->filled == 0 || write_block(w);
+    TrajectoryTrailer trailer = { w->offset, w->index_count, w->samples, { 0 }, 0 };
+    memcpy(trailer.magic, TRAJECTORY_TRAILER_MAGIC, 4);
+    ok = ok && async_io_write_copy(w->io, w->slot, w->index, w->index_count * sizeof(*w->index));
+    ok = ok && async_io_write_copy(w->io, w->slot, &trailer, sizeof(trailer));
+    ok = async_io_flush(w->io) && ok;
+    async_io_destroy(w->io);
+    ok = close(w->fd) == 0 && ok;
+    free(w->out.data);
+    free(w->index);
+    free(w->block);
+    free(w);
+    return ok;
+}
+
+static bool read_at(int fd, void *buf, size_t len, uint64_t offset) {
+    char *p = buf;
+    while (len > 0) {
+        ssize_t n = pread(fd, p, len, (off_t)offset);
+        if (n <= 0) return false;
+        p += n;
+        len -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return true;
+}
+
+TrajectoryReader *trajectory_reader_open(const char *path) {
+    TrajectoryReader *r = calloc(1, sizeof(*r));
+    if (!r) return NULL;
+    r->cached_block = -1;
+    r->fd = open(path, O_RDONLY);
+    struct stat st;
+    if (r->fd < 0 || fstat(r->fd, &st) != 0 ||
+        (uint64_t)st.st_size < sizeof(TrajectoryHeader) + sizeof(TrajectoryTrailer)) {
+        goto fail;
+    }
+    TrajectoryHeader *h = &r->header;
+    TrajectoryTrailer *t = &r->trailer;
+    uint64_t body = (uint64_t)st.st_size - sizeof(*t);
+    if (!read_at(r->fd, h, sizeof(*h), 0) ||
+        !read_at(r->fd, t, sizeof(*t), body) ||
+        memcmp(h->magic, TRAJECTORY_MAGIC, 4) != 0 || h->version != TRAJECTORY_VERSION ||
+        memcmp(t->magic, TRAJECTORY_TRAILER_MAGIC, 4) != 0 ||
+        h->pendulums == 0 || h->block_samples < 2 ||
+        h->pendulums > SIZE_MAX / sizeof(PendulumState) / h->block_samples) {
+        goto fail;
+    }
+    // The index must end where the trailer starts. Sizes come from the file,
+    // so they are checked against it before anything is computed from them.
+    if (t->block_count > (body - sizeof(*h)) / sizeof(TrajectoryIndexEntry)) goto fail;
+    size_t index_bytes = t->block_count * sizeof(TrajectoryIndexEntry);
+    if (t->index_offset != body - index_bytes) goto fail;
+    r->index = malloc(index_bytes + 1);
+    r->decoded = malloc((size_t)h->block_samples * h->pendulums * sizeof(PendulumState));
+    if (!r->index || !r->decoded ||
+        !read_at(r->fd, r->index, index_bytes, t->index_offset)) {
+        goto fail;
+    }
+    return r;
+
+fail:
+    trajectory_reader_close(r);
+    return NULL;
+}
+
+void trajectory_reader_close(TrajectoryReader *r) {
+    if (!r) return;
+    if (r->fd >= 0) close(r->fd);
+    free(r->index);
+    free(r->encoded);
+    free(r->decoded);
+    free(r);
+}
+
+const TrajectoryHeader *trajectory_reader_header(const TrajectoryReader *r) {
+    return &r->header;
+}
+
+uint64_t trajectory_reader_samples(const TrajectoryReader *r) {
+    return r->trailer.sample_count;
+}
+
+static bool load_block(TrajectoryReader *r, uint64_t b) {
+    if ((int64_t)b == r->cached_block) return true;
+    const TrajectoryIndexEntry *e = &r->index[b];
+    if (e->samples == 0 || e->samples > r->header.block_samples ||
+        e->offset > r->trailer.index_offset ||
+        e->bytes > r->trailer.index_offset - e->offset) {
+        return false;
+    }
+    if (e->bytes > r->encoded_capacity) {
+        uint8_t *buf = realloc(r->encoded, e->bytes);
+        if (!buf) return false;
+        r->encoded = buf;
+        r->encoded_capacity = e->bytes;
+    }
+    if (!read_at(r->fd, r->encoded, e->bytes, e->offset)) return false;
+
+    r->cached_block = -1;
+    BitReader rd = { r->encoded, e->bytes, 0, 0, 0 };
+    size_t stride = (size_t)r->header.pendulums * TRAJECTORY_CHANNELS;
+    for (uint32_t p = 0; p < r->header.pendulums; p++) {
+        for (int c = 0; c < TRAJECTORY_CHANNELS; c++) {
+            double *x = (double *)&r->decoded[p] + c;
+            double q = r->header.quantum[c];
+            if (q > 0.0) decode_quantized(&rd, x, stride, e->samples, q);
+            else if (!decode_xor(&rd, x, stride, e->samples)) return false;
+        }
+    }
+    // Running past the end means the block is truncated or corrupt.
+    if (rd.pos > rd.size) return false;
+    r->cached_block = (int64_t)b;
+    return true;
+}
+
+bool trajectory_reader_sample(TrajectoryReader *r, uint64_t index, PendulumState *states) {
+    if (index >= r->trailer.sample_count) return false;
+    uint64_t b = index / r->header.block_samples;
+    if (b >= r->trailer.block_count || !load_block(r, b)) return false;
+    uint64_t s = index % r->header.block_samples;
+    if (s >= r->index[b].samples) return false;
+    memcpy(states, &r->decoded[s * r->header.pendulums],
+           r->header.pendulums * sizeof(PendulumState));
+    return true;
+}
+
+bool trajectory_reader_at_time(TrajectoryReader *r, double t, PendulumState *states,
+                               uint64_t *index) {
+    if (r->trailer.sample_count == 0) return false;
+    double k = floor((t - r->header.t0) / r->header.dt + 1e-9);
+    uint64_t last = r->trailer.sample_count - 1;
+    uint64_t i = !(k > 0.0) ? 0 : k >= (double)last ? last : (uint64_t)k;
+    if (index) *index = i;
+    return trajectory_reader_sample(r, i, states);
+}
@@ -1,7 +1,22 @@
 #include "unity.h"
 #include "arithmetic.h"
 #include "pendulum.h"
+#include "parareal.h"
+#include "pendulum_engine.h"
+#include "shm_ring.h"
+#include "ensemble.h"
+#include "events.h"
+#include "deterministic.h"
+#include "async_io.h"
+#include "trajectory.h"
+#include "publisher.h"
+#include <fcntl.h>
 #include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/stat.h>
 
 void setUp(void) { }
 void tearDown(void) { }
@@ -137,11 +152,634 @@ void test_Reversibility(void) {
     TEST_ASSERT_DOUBLE_WITHIN(1e-6, t2_start, t2);
 }
 
+void test_ReducedPrecisionTracksDouble(void) {
+    double t1 = M_PI / 3, t2 = M_PI / 4, w1 = 0.2, w2 = -0.1;
+    double x1 = t1, x2 = t2, v1 = w1, v2 = w2;
+    float f1 = (float)t1, f2 = (float)t2, u1 = (float)w1, u2 = (float)w2;
+    double m1 = 1.0, m2 = 1.0;
+    double l1 = 1.0, l2 = 1.0;
+    double g = 9.81;
+    double dt = 0.01;
+
+    for (int i = 0; i < 100; i++) {
+        compute(t1, t2, w1, w2, m1, m2, l1, l2, g, dt, &t1, &t2, &w1, &w2);
+        compute_mixed(x1, x2, v1, v2, m1, m2, l1, l2, g, dt, &x1, &x2, &v1, &v2);
+        compute_f(f1, f2, u1, u2, (float)m1, (float)m2, (float)l1, (float)l2, (float)g, (float)dt,
+                  &f1, &f2, &u1, &u2);
+    }
+
+    TEST_ASSERT_DOUBLE_WITHIN(1e-5, t1, x1);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-5, t2, x2);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-4, t1, f1);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-4, t2, f2);
+}
+
+void test_PreparedMatchesCompute(void) {
+    // One general configuration and one that takes the symmetric path.
+    double params[2][4] = { { 1.0, 2.0, 1.5, 1.0 }, { 1.0, 1.0, 1.5, 1.5 } };
+    double g = 9.81;
+    double dt = 0.01;
+
+    for (int c = 0; c < 2; c++) {
+        double m1 = params[c][0], m2 = params[c][1];
+        double l1 = params[c][2], l2 = params[c][3];
+        PreparedConfig cfg;
+        prepare_config(&cfg, m1, m2, l1, l2, g);
+        TEST_ASSERT_TRUE(cfg.symmetric == (c == 1));
+
+        double t1 = M_PI / 3, t2 = M_PI / 4, w1 = 0.2, w2 = -0.1;
+        double p1 = t1, p2 = t2, v1 = w1, v2 = w2;
+        for (int i = 0; i < 100; i++) {
+            compute(t1, t2, w1, w2, m1, m2, l1, l2, g, dt, &t1, &t2, &w1, &w2);
+            compute_prepared(&cfg, p1, p2, v1, v2, dt, &p1, &p2, &v1, &v2);
+        }
+
+        TEST_ASSERT_DOUBLE_WITHIN(1e-10, t1, p1);
+        TEST_ASSERT_DOUBLE_WITHIN(1e-10, t2, p2);
+        TEST_ASSERT_DOUBLE_WITHIN(1e-10, w1, v1);
+        TEST_ASSERT_DOUBLE_WITHIN(1e-10, w2, v2);
+    }
+}
+
+void test_PararealMatchesSerial(void) {
+    PreparedConfig cfg;
+    prepare_config(&cfg, 1.0, 1.0, 1.0, 1.0, 9.81);
+    PendulumState start = { M_PI / 3, M_PI / 4, 0.2, -0.1 };
+
+    PararealOptions opts;
+    parareal_default_options(&opts, 2.0);
+    opts.slices = 4;
+    opts.threads = 4;
+    opts.fine_dt = 0.001;
+    opts.coarse_dt = 0.1;
+    opts.tolerance = 1e-10;
+
+    PararealResult r;
+    TEST_ASSERT_TRUE(parareal_solve(&cfg, &start, &opts, &r));
+    TEST_ASSERT_TRUE(r.converged);
+    TEST_ASSERT_TRUE(r.iterations <= opts.slices);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, opts.t_end, r.converged_until);
+
+    PendulumState serial;
+    parareal_serial(&cfg, &start, opts.t_end, opts.fine_dt, &serial);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-8, serial.theta1, r.final_state.theta1);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-8, serial.theta2, r.final_state.theta2);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-8, serial.omega1, r.final_state.omega1);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-8, serial.omega2, r.final_state.omega2);
+}
+
+void test_EngineBatchMatchesCompute(void) {
+    PendulumSimParams params = { 1.0, 2.0, 1.5, 1.0, 9.81 };
+    double dt = 0.01;
+    PendulumSim *sim = pendulum_sim_create(3, &params, dt);
+    TEST_ASSERT_NOT_NULL(sim);
+    TEST_ASSERT_EQUAL_UINT(3, pendulum_sim_count(sim));
+
+    PendulumSimState in[3] = {
+        { M_PI / 3, M_PI / 4, 0.2, -0.1 },
+        { 0.1, -0.2, 0.0, 0.0 },
+        { M_PI / 2, M_PI / 2, 0.0, 0.0 },
+    };
+    TEST_ASSERT_EQUAL_INT(PENDULUM_SIM_OK, pendulum_sim_set_state(sim, 0, 3, in));
+    TEST_ASSERT_EQUAL_INT(PENDULUM_SIM_OK, pendulum_sim_step(sim, 50));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, 0.5, pendulum_sim_time(sim));
+
+    PendulumSimState out[3];
+    TEST_ASSERT_EQUAL_INT(PENDULUM_SIM_OK, pendulum_sim_get_state(sim, 0, 3, out));
+    for (int p = 0; p < 3; p++) {
+        double t1 = in[p].theta1, t2 = in[p].theta2, w1 = in[p].omega1, w2 = in[p].omega2;
+        for (int i = 0; i < 50; i++) {
+            compute(t1, t2, w1, w2, params.m1, params.m2, params.l1, params.l2, params.g, dt,
+                    &t1, &t2, &w1, &w2);
+        }
+        TEST_ASSERT_DOUBLE_WITHIN(1e-10, t1, out[p].theta1);
+        TEST_ASSERT_DOUBLE_WITHIN(1e-10, t2, out[p].theta2);
+        TEST_ASSERT_DOUBLE_WITHIN(1e-10, w1, out[p].omega1);
+        TEST_ASSERT_DOUBLE_WITHIN(1e-10, w2, out[p].omega2);
+    }
+
+    double energy[2];
+    double start_E = get_total_energy(params.m1, params.m2, params.l1, params.l2,
+                                      in[1].theta1, in[1].theta2, in[1].omega1, in[1].omega2, params.g);
+    TEST_ASSERT_EQUAL_INT(PENDULUM_SIM_OK, pendulum_sim_extract(sim, PENDULUM_SIM_ENERGY, 1, 2, energy));
+    TEST_ASSERT_DOUBLE_WITHIN(fabs(start_E) * 1e-6, start_E, energy[0]);
+
+    TEST_ASSERT_EQUAL_INT(PENDULUM_SIM_ERANGE, pendulum_sim_get_state(sim, 2, 2, out));
+    TEST_ASSERT_EQUAL_INT(PENDULUM_SIM_ERANGE, pendulum_sim_extract(sim, PENDULUM_SIM_THETA1, 4, 0, energy));
+    TEST_ASSERT_EQUAL_INT(PENDULUM_SIM_EINVAL, pendulum_sim_set_dt(sim, 0.0));
+    pendulum_sim_destroy(sim);
+
+    // 4 * count would wrap to a small allocation.
+    TEST_ASSERT_NULL(pendulum_sim_create(SIZE_MAX / 4 + 2, &params, dt));
+    params.l1 = 0.0;
+    TEST_ASSERT_NULL(pendulum_sim_create(3, &params, dt));
+}
+
+void test_ShmRingSequenceAndOverrun(void) {
+    ShmRing producer, consumer;
+    TEST_ASSERT_TRUE(shm_ring_create(&producer, "/pendulum_test_ring", 10));
+    TEST_ASSERT_TRUE(shm_ring_open(&consumer, "/pendulum_test_ring"));
+    // Group read-write whatever the umask, for consumers in the producer's group.
+    struct stat st;
+    TEST_ASSERT_EQUAL_INT(0, fstat(producer.fd, &st));
+    TEST_ASSERT_EQUAL_INT(0660, st.st_mode & 0777);
+    // The name stays with the live producer.
+    ShmRing second;
+    TEST_ASSERT_FALSE(shm_ring_create(&second, "/pendulum_test_ring", 10));
+
+    ShmRingReader reader;
+    shm_ring_reader_init(&reader, &consumer, true);
+    TEST_ASSERT_FALSE(shm_ring_wait(&reader, 0));
+
+    uint64_t words[40];
+    for (uint64_t i = 0; i < 40; i++) words[i] = 1000 + i;
+    shm_ring_publish_batch(&producer, words, 5);
+    TEST_ASSERT_TRUE(shm_ring_wait(&reader, 0));
+
+    uint64_t out[40];
+    uint64_t seq;
+    TEST_ASSERT_EQUAL_UINT(5, shm_ring_read(&reader, out, 40, &seq));
+    TEST_ASSERT_EQUAL_UINT64(0, seq);
+    TEST_ASSERT_EQUAL_UINT64(1004, out[4]);
+    TEST_ASSERT_EQUAL_UINT(0, shm_ring_read(&reader, out, 40, &seq));
+
+    // Capacity rounds up to 16; publishing 35 more overruns the reader by 19.
+    shm_ring_publish_batch(&producer, words + 5, 35);
+    TEST_ASSERT_EQUAL_UINT(16, shm_ring_read(&reader, out, 40, &seq));
+    TEST_ASSERT_EQUAL_UINT64(24, seq);
+    TEST_ASSERT_EQUAL_UINT64(19, reader.lost);
+    TEST_ASSERT_EQUAL_UINT64(1024, out[0]);
+    TEST_ASSERT_EQUAL_UINT64(1039, out[15]);
+
+    shm_ring_close(&consumer);
+    shm_ring_close(&producer);
+}
+
+void test_EnsembleThreadsAndTrails(void) {
+    const size_t count = 1500;
+    PendulumState out_single, out_multi;
+    Ensemble *ens[2];
+
+    for (int k = 0; k < 2; k++) {
+        EnsembleOptions opts;
+        ensemble_default_options(&opts);
+        opts.threads = k == 0 ? 1 : 3;
+        opts.trail_length = 8;
+        opts.trail_decimation = 5;
+        ens[k] = ensemble_create(count, &opts);
+        TEST_ASSERT_NOT_NULL(ens[k]);
+        int cfg = ensemble_add_config(ens[k], 1.0, 2.0, 1.5, 1.0, 9.81);
+        TEST_ASSERT_EQUAL_INT(0, cfg);
+        for (size_t i = 0; i < count; i++) {
+            PendulumState s = { 0.5 + 1e-3 * i, -0.3, 0.1, 0.0 };
+            TEST_ASSERT_TRUE(ensemble_set_pendulum(ens[k], i, cfg, &s, 255, 0, 0));
+        }
+        TEST_ASSERT_TRUE(ensemble_enable_trail(ens[k], 1200));
+        ensemble_step(ens[k], 0.01, 30);
+    }
+
+    PreparedConfig cfg;
+    prepare_config(&cfg, 1.0, 2.0, 1.5, 1.0, 9.81);
+    size_t probe[] = { 0, 511, 512, 1200, count - 1 };
+    for (size_t p = 0; p < sizeof(probe) / sizeof(probe[0]); p++) {
+        size_t i = probe[p];
+        PendulumState ref = { 0.5 + 1e-3 * i, -0.3, 0.1, 0.0 };
+        for (int s = 0; s < 30; s++) {
+            compute_prepared(&cfg, ref.theta1, ref.theta2, ref.omega1, ref.omega2, 0.01,
+                             &ref.theta1, &ref.theta2, &ref.omega1, &ref.omega2);
+        }
+        ensemble_get_state(ens[0], i, &out_single);
+        ensemble_get_state(ens[1], i, &out_multi);
+        TEST_ASSERT_EQUAL_DOUBLE(ref.theta1, out_single.theta1);
+        TEST_ASSERT_EQUAL_DOUBLE(ref.omega2, out_single.omega2);
+        TEST_ASSERT_EQUAL_DOUBLE(ref.theta1, out_multi.theta1);
+        TEST_ASSERT_EQUAL_DOUBLE(ref.omega2, out_multi.omega2);
+    }
+
+    // 30 steps with a point every 5th step: 6 points, all within reach.
+    float xy[16];
+    TEST_ASSERT_EQUAL_UINT(6, ensemble_trail(ens[1], 1200, xy, 8));
+    TEST_ASSERT_EQUAL_UINT(0, ensemble_trail(ens[1], 0, xy, 8));
+    ensemble_get_state(ens[1], 1200, &out_multi);
+    double x2 = 1.5 * sin(out_multi.theta1) + 1.0 * sin(out_multi.theta2);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-5, x2, xy[10]);
+    TEST_ASSERT_TRUE(ensemble_memory_bytes(ens[1]) < count * sizeof(Pendulum) / 10);
+
+    ensemble_destroy(ens[0]);
+    ensemble_destroy(ens[1]);
+}
+
+// Time of the third theta1 = 0, omega1 > 0 crossing, stepping with dt.
+static double third_section_crossing(double dt, PendulumState *at) {
+    PreparedConfig cfg;
+    prepare_config(&cfg, 1.0, 1.0, 1.0, 1.0, 9.81);
+    EventSpec section = { event_theta1_section, event_accept_theta1_down, EVENT_RISING, NULL };
+    PendulumState s = { 0.3, -0.2, 0.5, 0.0 };
+    int found = 0;
+    for (double t = 0.0; t < 10.0; t += dt) {
+        EventHit hit;
+        if (event_step(&cfg, &s, t, dt, &section, 1, &hit, 1) == 1 && ++found == 3) {
+            *at = hit.state;
+            return hit.t;
+        }
+    }
+    return -1.0;
+}
+
+void test_EventLocationIndependentOfStep(void) {
+    PendulumState coarse, fine;
+    double t_coarse = third_section_crossing(0.01, &coarse);
+    double t_fine = third_section_crossing(0.0005, &fine);
+
+    TEST_ASSERT_TRUE(t_coarse > 0.0);
+    // A sign-change check would only pin this down to within dt.
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, t_fine, t_coarse);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, 0.0, sin(coarse.theta1));
+    TEST_ASSERT_TRUE(coarse.omega1 > 0.0);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-5, fine.theta2, coarse.theta2);
+}
+
+static double theta1_minus(const PendulumState *s, void *ctx) {
+    return s->theta1 - *(const double *)ctx;
+}
+
+// A step that ends exactly on the surface reports the step end.
+void test_EventOnStepEnd(void) {
+    PreparedConfig cfg;
+    prepare_config(&cfg, 1.0, 1.0, 1.0, 1.0, 9.81);
+    PendulumState s = { 0.3, -0.2, 0.5, 0.0 };
+    double target;
+    PendulumState end;
+    compute_prepared(&cfg, s.theta1, s.theta2, s.omega1, s.omega2, 0.01,
+                     &target, &end.theta2, &end.omega1, &end.omega2);
+    EventSpec e = { theta1_minus, NULL, EVENT_RISING, &target };
+    EventHit hit;
+    TEST_ASSERT_EQUAL_UINT(1, event_step(&cfg, &s, 2.0, 0.01, &e, 1, &hit, 1));
+    TEST_ASSERT_EQUAL_DOUBLE(2.01, hit.t);
+    TEST_ASSERT_EQUAL_DOUBLE(target, hit.state.theta1);
+}
+
+void test_DeterministicTrigMatchesLibm(void) {
+    for (int i = -20000; i <= 20000; i++) {
+        double x = i * 0.0123;
+        TEST_ASSERT_DOUBLE_WITHIN(2e-16 * fmax(1.0, fabs(sin(x))), sin(x), det_sin(x));
+        TEST_ASSERT_DOUBLE_WITHIN(2e-16 * fmax(1.0, fabs(cos(x))), cos(x), det_cos(x));
+    }
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, det_sin(0.0));
+    TEST_ASSERT_TRUE(isnan(det_cos(INFINITY)));
+}
+
+// Batch of 600 pendulums: two full blocks and a partial one.
+#define DET_N 600
+
+// Divisions, so that FMA targets cannot contract the inputs differently.
+static void det_initial(double *t1, double *t2, double *w1, double *w2) {
+    for (int i = 0; i < DET_N; i++) {
+        t1[i] = 0.5 + i / 1000.0;
+        t2[i] = -0.3 + i / 500.0;
+        w1[i] = 0.0;
+        w2[i] = 0.1;
+    }
+}
+
+static void det_hex(const double *t1, const double *t2, const double *w1, const double *w2,
+                    char hex[2 * SHA256_BLOCK_SIZE + 1]) {
+    uint8_t hash[SHA256_BLOCK_SIZE];
+    deterministic_hash(t1, t2, w1, w2, DET_N, hash);
+    for (int i = 0; i < SHA256_BLOCK_SIZE; i++) sprintf(hex + 2 * i, "%02x", hash[i]);
+}
+
+void test_DeterministicIndependentOfThreads(void) {
+    static double t1[DET_N], t2[DET_N], w1[DET_N], w2[DET_N];
+    // Produced by this test on x86-64; any build or machine must match it.
+    const char *golden = "52fe154d35ac7f99c19d185065e8101bfe2d971aaf0f5b0909208d839ea09728";
+    char first[2 * SHA256_BLOCK_SIZE + 1];
+    double first_energy = 0.0;
+
+    const int threads[] = { 1, 2, 7 };
+    for (int k = 0; k < 3; k++) {
+        det_initial(t1, t2, w1, w2);
+        compute_batch_deterministic(t1, t2, w1, w2, DET_N, 1.0, 1.5, 1.0, 0.8, 9.81, 0.01,
+                                    500, threads[k]);
+        char hex[2 * SHA256_BLOCK_SIZE + 1];
+        det_hex(t1, t2, w1, w2, hex);
+        double energy = deterministic_energy(t1, t2, w1, w2, DET_N, 1.0, 1.5, 1.0, 0.8, 9.81,
+                                             threads[k]);
+        if (k == 0) {
+            strcpy(first, hex);
+            first_energy = energy;
+        }
+        TEST_ASSERT_EQUAL_STRING(first, hex);
+        TEST_ASSERT_EQUAL_MEMORY(&first_energy, &energy, sizeof(energy));
+    }
+    TEST_ASSERT_EQUAL_STRING(golden, first);
+
+    // The scalar step, one pendulum at a time, gives the same bits.
+    det_initial(t1, t2, w1, w2);
+    for (int i = 0; i < DET_N; i++) {
+        for (int s = 0; s < 500; s++) {
+            compute_deterministic(t1[i], t2[i], w1[i], w2[i], 1.0, 1.5, 1.0, 0.8, 9.81, 0.01,
+                                  &t1[i], &t2[i], &w1[i], &w2[i]);
+        }
+    }
+    char scalar[2 * SHA256_BLOCK_SIZE + 1];
+    det_hex(t1, t2, w1, w2, scalar);
+    TEST_ASSERT_EQUAL_STRING(first, scalar);
+}
+
+typedef struct {
+    int count;
+    bool in_order;
+} RecvCheck;
+
+static void check_datagram(const char *data, size_t len, void *ctx) {
+    RecvCheck *check = ctx;
+    uint32_t value;
+    if (len != sizeof(value)) {
+        check->in_order = false;
+        return;
+    }
+    memcpy(&value, data, sizeof(value));
+    if (value != (uint32_t)check->count) check->in_order = false;
+    check->count++;
+}
+
+// A submit batch larger than the ring makes the submission queue fill up.
+static void async_io_roundtrip(bool force_blocking, unsigned submit_batch) {
+    AsyncIoOptions opts;
+    async_io_default_options(&opts);
+    opts.buffer_size = 4096;
+    opts.buffer_count = 8;
+    opts.queue_depth = 8;
+    opts.submit_batch = submit_batch;
+    opts.force_blocking = force_blocking;
+    AsyncIo *io = async_io_create(&opts);
+    TEST_ASSERT_NOT_NULL(io);
+
+    // More data than the buffer pool holds, so buffers are recycled.
+    char path[] = "/tmp/pendulum_async_io_XXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    unlink(path);
+    int slot = async_io_add_file(io, fd);
+    TEST_ASSERT_TRUE(slot >= 0);
+    static unsigned char pattern[100000];
+    for (size_t i = 0; i < sizeof(pattern); i++) pattern[i] = (unsigned char)(i * 7 + i / 251);
+    TEST_ASSERT_TRUE(async_io_write_copy(io, slot, pattern, 12345));
+    TEST_ASSERT_TRUE(async_io_write_copy(io, slot, pattern + 12345, sizeof(pattern) - 12345));
+    TEST_ASSERT_TRUE(async_io_flush(io));
+    TEST_ASSERT_TRUE(lseek(fd, 0, SEEK_CUR) == (off_t)sizeof(pattern));
+    static unsigned char back[sizeof(pattern)];
+    TEST_ASSERT_TRUE(pread(fd, back, sizeof(back), 0) == (ssize_t)sizeof(back));
+    TEST_ASSERT_EQUAL_MEMORY(pattern, back, sizeof(pattern));
+    close(fd);
+
+    // Streams are written at the current position, in order.
+    int pipe_fds[2];
+    TEST_ASSERT_EQUAL_INT(0, pipe(pipe_fds));
+    int pipe_slot = async_io_add_file(io, pipe_fds[1]);
+    TEST_ASSERT_TRUE(async_io_write_copy(io, pipe_slot, pattern, 10000));
+    TEST_ASSERT_TRUE(async_io_flush(io));
+    // The ring's file table still references the write end, so no EOF.
+    size_t got = 0;
+    ssize_t n;
+    while (got < 10000 && (n = read(pipe_fds[0], back + got, 10000 - got)) > 0) got += (size_t)n;
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    TEST_ASSERT_EQUAL_UINT(10000, got);
+    TEST_ASSERT_EQUAL_MEMORY(pattern, back, 10000);
+
+    // UDP loopback receive.
+    int rx = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    TEST_ASSERT_EQUAL_INT(0, bind(rx, (struct sockaddr *)&addr, sizeof(addr)));
+    socklen_t addr_len = sizeof(addr);
+    getsockname(rx, (struct sockaddr *)&addr, &addr_len);
+    int rx_slot = async_io_add_file(io, rx);
+    TEST_ASSERT_TRUE(async_io_recv_start(io, rx_slot, 4));
+
+    int tx = socket(AF_INET, SOCK_DGRAM, 0);
+    RecvCheck check = { 0, true };
+    for (uint32_t i = 0; i < 50; i++) {
+        sendto(tx, &i, sizeof(i), 0, (struct sockaddr *)&addr, sizeof(addr));
+        if (i % 10 == 9) {
+            while (check.count <= (int)i && async_io_recv_poll(io, check_datagram, &check, 1000) > 0) {}
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(50, check.count);
+    TEST_ASSERT_TRUE(check.in_order);
+    TEST_ASSERT_EQUAL_INT(0, async_io_recv_poll(io, check_datagram, &check, 0));
+    TEST_ASSERT_EQUAL_INT(0, async_io_error(io));
+
+    async_io_destroy(io);
+    close(tx);
+    close(rx);
+}
+
+void test_AsyncIoWritesAndReceives(void) {
+    async_io_roundtrip(false, 8);
+    async_io_roundtrip(false, 64);
+    async_io_roundtrip(true, 8);
+}
+
+// 3 pendulums, 700 samples: two full blocks of 256 and a partial one.
+#define TRAJ_N 3
+#define TRAJ_SAMPLES 700
+
+static void trajectory_roundtrip(const double quantum[TRAJECTORY_CHANNELS]) {
+    static PendulumState recorded[TRAJ_SAMPLES][TRAJ_N];
+    PendulumState s[TRAJ_N];
+    for (int p = 0; p < TRAJ_N; p++) s[p] = (PendulumState){ 1.0 + 0.5 * p, -0.5, 0.0, 0.2 };
+
+    TrajectoryOptions opts;
+    trajectory_default_options(&opts);
+    memcpy(opts.quantum, quantum, sizeof(opts.quantum));
+    char path[] = "/tmp/pendulum_trajectory_XXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    close(fd);
+    TrajectoryWriter *w = trajectory_writer_open(path, TRAJ_N, 2.0, 0.01, &opts);
+    TEST_ASSERT_NOT_NULL(w);
+    for (int i = 0; i < TRAJ_SAMPLES; i++) {
+        memcpy(recorded[i], s, sizeof(s));
+        TEST_ASSERT_TRUE(trajectory_writer_append(w, s));
+        for (int p = 0; p < TRAJ_N; p++) {
+            compute(s[p].theta1, s[p].theta2, s[p].omega1, s[p].omega2, 1.0, 1.5, 1.0, 0.8,
+                    9.81, 0.01, &s[p].theta1, &s[p].theta2, &s[p].omega1, &s[p].omega2);
+        }
+    }
+    TEST_ASSERT_TRUE(trajectory_writer_close(w));
+
+    TrajectoryReader *r = trajectory_reader_open(path);
+    TEST_ASSERT_NOT_NULL(r);
+    TEST_ASSERT_TRUE(trajectory_reader_samples(r) == TRAJ_SAMPLES);
+    // Out of order, so blocks are decoded again after the cache moves on.
+    PendulumState back[TRAJ_N];
+    for (int k = 0; k < TRAJ_SAMPLES; k++) {
+        int i = (k * 37) % TRAJ_SAMPLES;
+        TEST_ASSERT_TRUE(trajectory_reader_sample(r, (uint64_t)i, back));
+        for (int p = 0; p < TRAJ_N; p++) {
+            const double *want = &recorded[i][p].theta1, *got = &back[p].theta1;
+            for (int c = 0; c < TRAJECTORY_CHANNELS; c++) {
+                if (quantum[c] > 0.0) TEST_ASSERT_TRUE(fabs(got[c] - want[c]) <= 0.5 * quantum[c] * (1 + 1e-9));
+                else TEST_ASSERT_EQUAL_MEMORY(&want[c], &got[c], sizeof(double));
+            }
+        }
+    }
+    TEST_ASSERT_FALSE(trajectory_reader_sample(r, TRAJ_SAMPLES, back));
+
+    uint64_t index;
+    TEST_ASSERT_TRUE(trajectory_reader_at_time(r, 2.0 + 600 * 0.01, back, &index));
+    TEST_ASSERT_TRUE(index == 600);
+    TEST_ASSERT_TRUE(trajectory_reader_at_time(r, 2.0 + 3.456, back, &index));
+    TEST_ASSERT_TRUE(index == 345);
+    TEST_ASSERT_TRUE(trajectory_reader_at_time(r, 1e9, back, &index));
+    TEST_ASSERT_TRUE(index == TRAJ_SAMPLES - 1);
+    TEST_ASSERT_TRUE(trajectory_reader_at_time(r, 0.0, back, &index));
+    TEST_ASSERT_TRUE(index == 0);
+    trajectory_reader_close(r);
+
+    // A block count whose index size wraps to the real one must be rejected.
+    TrajectoryTrailer t;
+    fd = open(path, O_RDWR);
+    off_t end = lseek(fd, 0, SEEK_END);
+    TEST_ASSERT_TRUE(pread(fd, &t, sizeof(t), end - (off_t)sizeof(t)) == (ssize_t)sizeof(t));
+    t.block_count += 1ull << 60;
+    TEST_ASSERT_TRUE(pwrite(fd, &t, sizeof(t), end - (off_t)sizeof(t)) == (ssize_t)sizeof(t));
+    close(fd);
+    TEST_ASSERT_NULL(trajectory_reader_open(path));
+    unlink(path);
+    TEST_ASSERT_NULL(trajectory_writer_open("/nonexistent/trajectory", TRAJ_N, 0.0, 0.01, &opts));
+}
+
+void test_TrajectoryRoundTrip(void) {
+    const double lossless[TRAJECTORY_CHANNELS] = { 0 };
+    const double lossy[TRAJECTORY_CHANNELS] = { 1e-6, 1e-6, 1e-4, 0.0 };
+    trajectory_roundtrip(lossless);
+    trajectory_roundtrip(lossy);
+}
+
+// Subscribers on loopback with mixed topics and decimations. Loopback
+// delivers during the send, so each socket can be drained without waiting.
+#define PUB_SUBS 12
+#define PUB_BATCHES 8
+#define PUB_STATES 100
+
+void test_PublisherFansOut(void) {
+    Publisher *pub = publisher_create();
+    TEST_ASSERT_NOT_NULL(pub);
+    int socks[PUB_SUBS];
+    unsigned topics[PUB_SUBS], decimation[PUB_SUBS];
+    for (int i = 0; i < PUB_SUBS; i++) {
+        socks[i] = socket(AF_INET, SOCK_DGRAM, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        TEST_ASSERT_EQUAL_INT(0, bind(socks[i], (struct sockaddr *)&addr, sizeof(addr)));
+        socklen_t len = sizeof(addr);
+        getsockname(socks[i], (struct sockaddr *)&addr, &len);
+        const char *names[] = { "state", "random", "all" };
+        topics[i] = i % 3 == 0 ? PUBLISH_STATE : i % 3 == 1 ? PUBLISH_RANDOM : PUBLISH_ALL;
+        decimation[i] = 1 + i % 4;
+        char spec[64];
+        snprintf(spec, sizeof(spec), "127.0.0.1:%d/%s/%u", ntohs(addr.sin_port),
+                 names[i % 3], decimation[i]);
+        TEST_ASSERT_TRUE(publisher_add_spec(pub, spec));
+    }
+    // One subscriber in the plain decimal format of older viewers.
+    int text_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in text_addr;
+    memset(&text_addr, 0, sizeof(text_addr));
+    text_addr.sin_family = AF_INET;
+    text_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    TEST_ASSERT_EQUAL_INT(0, bind(text_sock, (struct sockaddr *)&text_addr, sizeof(text_addr)));
+    socklen_t text_len = sizeof(text_addr);
+    getsockname(text_sock, (struct sockaddr *)&text_addr, &text_len);
+    char text_spec[64];
+    snprintf(text_spec, sizeof(text_spec), "127.0.0.1:%d/text", ntohs(text_addr.sin_port));
+    TEST_ASSERT_TRUE(publisher_add_spec(pub, text_spec));
+    TEST_ASSERT_EQUAL_INT(PUB_SUBS + 1, publisher_subscribers(pub));
+    TEST_ASSERT_FALSE(publisher_add_spec(pub, "127.0.0.1:9/bogus"));
+
+    static PendulumState states[PUB_STATES];
+    for (int b = 0; b < PUB_BATCHES; b++) {
+        for (int k = 0; k < PUB_STATES; k++) {
+            states[k] = (PendulumState){ b * PUB_STATES + k, 0.0, 0.0, 0.0 };
+        }
+        uint64_t word = 1000 + b;
+        TEST_ASSERT_TRUE(publisher_send(pub, PUBLISH_STATE, b, states, PUB_STATES));
+        TEST_ASSERT_TRUE(publisher_send(pub, PUBLISH_RANDOM, b, &word, 1));
+        TEST_ASSERT_TRUE(publisher_send(pub, PUBLISH_TEXT, b, &word, 1));
+    }
+
+    uint64_t datagrams = 0;
+    for (int i = 0; i < PUB_SUBS; i++) {
+        int due = (PUB_BATCHES + decimation[i] - 1) / decimation[i];
+        int state_records = 0, random_records = 0;
+        bool values_ok = true;
+        _Alignas(8) char buf[PUBLISH_MAX_DATAGRAM];
+        ssize_t n;
+        while ((n = recv(socks[i], buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+            datagrams++;
+            PublishHeader h;
+            const void *records;
+            TEST_ASSERT_TRUE(publish_decode(buf, (size_t)n, &h, &records));
+            TEST_ASSERT_TRUE(h.topic & topics[i]);
+            // Batches reach the subscriber every decimation-th time.
+            TEST_ASSERT_EQUAL_INT(0, (int)h.time % (int)decimation[i]);
+            if (h.topic == PUBLISH_STATE) {
+                const PendulumState *st = records;
+                for (int k = 0; k < h.count; k++) {
+                    if (st[k].theta1 != (double)(h.sequence + k)) values_ok = false;
+                }
+                state_records += h.count;
+            } else {
+                const uint64_t *w = records;
+                if (w[0] != 1000 + (uint64_t)h.time || h.sequence != (uint64_t)h.time) values_ok = false;
+                random_records += h.count;
+            }
+        }
+        TEST_ASSERT_TRUE(values_ok);
+        TEST_ASSERT_EQUAL_INT(topics[i] & PUBLISH_STATE ? due * PUB_STATES : 0, state_records);
+        TEST_ASSERT_EQUAL_INT(topics[i] & PUBLISH_RANDOM ? due : 0, random_records);
+        close(socks[i]);
+    }
+    for (int b = 0; b < PUB_BATCHES; b++) {
+        char text[32], expected[32];
+        ssize_t n = recv(text_sock, text, sizeof(text) - 1, MSG_DONTWAIT);
+        TEST_ASSERT_TRUE(n > 0);
+        text[n] = 0;
+        snprintf(expected, sizeof(expected), "%d", 1000 + b);
+        TEST_ASSERT_EQUAL_STRING(expected, text);
+        datagrams++;
+    }
+    close(text_sock);
+    TEST_ASSERT_TRUE(datagrams == publisher_datagrams_sent(pub));
+    publisher_destroy(pub);
+}
+
 int main(void) {
     UNITY_BEGIN();
     RUN_TEST(test_Equilibrium);
     RUN_TEST(test_ZeroGravity);
     RUN_TEST(test_EnergyConservation);
     RUN_TEST(test_Reversibility);
+    RUN_TEST(test_ReducedPrecisionTracksDouble);
+    RUN_TEST(test_PreparedMatchesCompute);
+    RUN_TEST(test_PararealMatchesSerial);
+    RUN_TEST(test_EngineBatchMatchesCompute);
+    RUN_TEST(test_ShmRingSequenceAndOverrun);
+    RUN_TEST(test_EnsembleThreadsAndTrails);
+    RUN_TEST(test_EventLocationIndependentOfStep);
+    RUN_TEST(test_EventOnStepEnd);
+    RUN_TEST(test_DeterministicTrigMatchesLibm);
+    RUN_TEST(test_DeterministicIndependentOfThreads);
+    RUN_TEST(test_AsyncIoWritesAndReceives);
+    RUN_TEST(test_TrajectoryRoundTrip);
+    RUN_TEST(test_PublisherFansOut);
     return UNITY_END();
 }
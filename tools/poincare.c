@@ -0,0 +1,233 @@
+// poincare.c - Poincare sections (theta1 = 0, omega1 > 0) for a range of
+// energies, computed in parallel and streamed to a compact binary file.
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "async_io.h"
+#include "events.h"
+#include "poincare_format.h"
+
+#define MAX_THREADS 256
+
+typedef struct {
+    int energies;
+    int orbits;
+    double e_min;
+    double e_max;
+    double t_end;
+    double dt;
+    int threads;
+    const char *out_path;
+} PoincareArgs;
+
+typedef struct {
+    const PoincareArgs *args;
+    const PreparedConfig *cfg;
+    const double *energy;
+    atomic_int next_energy;
+    pthread_mutex_t out_lock;     // serializes use of io
+    AsyncIo *io;
+    int out_slot;
+    atomic_ulong points;
+    atomic_bool failed;           // a worker lost its output buffer
+} PoincareJob;
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-n energies] [-o orbits] [-e emin emax] [-t seconds] [-d dt] [-j threads] out.pcs\n"
+            "Energies are in joules for m1 = m2 = 1 kg, l1 = l2 = 1 m, g = 9.81 m/s^2;\n"
+            "the pendulum at rest hanging down has E = -29.43 J.\n", prog);
+}
+
+static bool parse_args(int argc, char *argv[], PoincareArgs *a) {
+    a->energies = 16;
+    a->orbits = 20;
+    a->e_min = -20.0;
+    a->e_max = 0.0;
+    a->t_end = 200.0;
+    a->dt = 0.01;
+    a->threads = 4;
+    a->out_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) a->energies = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) a->orbits = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-e") == 0 && i + 2 < argc) {
+            a->e_min = atof(argv[++i]);
+            a->e_max = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) a->t_end = atof(argv[++i]);
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) a->dt = atof(argv[++i]);
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) a->threads = atoi(argv[++i]);
+        else if (argv[i][0] != '-' && !a->out_path) a->out_path = argv[i];
+        else return false;
+    }
+    return a->out_path && a->energies > 0 && a->energies <= UINT16_MAX &&
+           a->orbits > 0 && a->orbits <= UINT16_MAX && a->threads > 0 && a->threads <= MAX_THREADS &&
+           a->t_end > 0.0 && a->dt > 0.0;
+}
+
+// Workers fill registered I/O buffers directly; only taking and queueing a
+// buffer happens under the lock, the write itself completes in the background.
+static PoincarePoint *take_points(PoincareJob *job, size_t *capacity) {
+    size_t bytes;
+    pthread_mutex_lock(&job->out_lock);
+    char *buf = async_io_get_buffer(job->io, &bytes);
+    pthread_mutex_unlock(&job->out_lock);
+    *capacity = bytes / sizeof(PoincarePoint);
+    return (PoincarePoint *)buf;
+}
+
+static bool queue_points(PoincareJob *job, PoincarePoint *buf, size_t n) {
+    pthread_mutex_lock(&job->out_lock);
+    bool ok = async_io_write(job->io, job->out_slot, (char *)buf, n * sizeof(PoincarePoint));
+    pthread_mutex_unlock(&job->out_lock);
+    if (ok) atomic_fetch_add(&job->points, n);
+    return ok;
+}
+
+// Orbits of one energy start on the section (theta1 = 0, omega2 = 0) with
+// theta2 spread over the accessible range and omega1 > 0 fixed by the energy.
+static bool initial_state(const PreparedConfig *c, double energy, int orbit, int orbits,
+                          PendulumState *s) {
+    s->theta1 = 0.0;
+    s->theta2 = -M_PI + 2.0 * M_PI * (orbit + 0.5) / orbits;
+    s->omega2 = 0.0;
+    double v = -(c->m1 + c->m2) * c->g * c->l1 - c->m2 * c->g * c->l2 * cos(s->theta2);
+    if (energy < v) return false;
+    s->omega1 = sqrt(2.0 * (energy - v) / ((c->m1 + c->m2) * c->l1 * c->l1));
+    return true;
+}
+
+static void *worker(void *arg) {
+    PoincareJob *job = arg;
+    const PoincareArgs *a = job->args;
+    size_t capacity;
+    PoincarePoint *buf = take_points(job, &capacity);
+    if (!buf) {
+        atomic_store(&job->failed, true);
+        return NULL;
+    }
+    size_t buffered = 0;
+    EventSpec section = { event_theta1_section, event_accept_theta1_down, EVENT_RISING, NULL };
+    long steps = (long)ceil(a->t_end / a->dt);
+
+    int e;
+    while (!atomic_load(&job->failed) &&
+           (e = atomic_fetch_add(&job->next_energy, 1)) < a->energies) {
+        for (int o = 0; o < a->orbits; o++) {
+            PendulumState s;
+            if (!initial_state(job->cfg, job->energy[e], o, a->orbits, &s)) continue;
+            for (long k = 0; k < steps; k++) {
+                EventHit hit;
+                if (event_step(job->cfg, &s, k * a->dt, a->dt, &section, 1, &hit, 1) == 0) continue;
+                buf[buffered++] = (PoincarePoint){
+                    (uint16_t)e, (uint16_t)o,
+                    (float)remainder(hit.state.theta2, 2.0 * M_PI), (float)hit.state.omega2
+                };
+                if (buffered == capacity) {
+                    bool ok = queue_points(job, buf, buffered);
+                    buffered = 0;
+                    buf = ok ? take_points(job, &capacity) : NULL;
+                    if (!buf) {
+                        atomic_store(&job->failed, true);
+                        return NULL;
+                    }
+                }
+            }
+        }
+    }
+    if (!queue_points(job, buf, buffered)) atomic_store(&job->failed, true);
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    PoincareArgs args;
+    if (!parse_args(argc, argv, &args)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    PreparedConfig cfg;
+    prepare_config(&cfg, 1.0, 1.0, 1.0, 1.0, 9.81);
+
+    double *energy = malloc(args.energies * sizeof(double));
+    if (!energy) return 1;
+    for (int i = 0; i < args.energies; i++) {
+        energy[i] = args.energies == 1 ? args.e_min
+                  : args.e_min + (args.e_max - args.e_min) * i / (args.energies - 1);
+    }
+
+    int fd = open(args.out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror(args.out_path);
+        free(energy);
+        return 1;
+    }
+    AsyncIoOptions io_opts;
+    async_io_default_options(&io_opts);
+    // Every worker holds one buffer while it fills it; the rest keep writes
+    // in flight, so a worker never finds the pool empty with nothing to reap.
+    if (io_opts.buffer_count < 2u * (unsigned)args.threads) {
+        io_opts.buffer_count = 2u * (unsigned)args.threads;
+    }
+    AsyncIo *io = async_io_create(&io_opts);
+    if (!io) {
+        close(fd);
+        free(energy);
+        return 1;
+    }
+    int out_slot = async_io_add_file(io, fd);
+    PoincareHeader header = {
+        .version = POINCARE_VERSION,
+        .energy_count = (uint32_t)args.energies,
+        .orbits_per_energy = (uint32_t)args.orbits,
+        .m1 = cfg.m1, .m2 = cfg.m2, .l1 = cfg.l1, .l2 = cfg.l2, .g = cfg.g,
+        .t_end = args.t_end,
+        .dt = args.dt,
+    };
+    memcpy(header.magic, POINCARE_MAGIC, 4);
+    async_io_write_copy(io, out_slot, &header, sizeof(header));
+    async_io_write_copy(io, out_slot, energy, args.energies * sizeof(double));
+
+    PoincareJob job = { .args = &args, .cfg = &cfg, .energy = energy, .io = io, .out_slot = out_slot };
+    atomic_init(&job.next_energy, 0);
+    atomic_init(&job.points, 0);
+    atomic_init(&job.failed, false);
+    pthread_mutex_init(&job.out_lock, NULL);
+
+    pthread_t tids[args.threads];
+    int started = 0;
+    for (int t = 0; t < args.threads; t++) {
+        if (pthread_create(&tids[t], NULL, worker, &job) != 0) break;
+        started++;
+    }
+    if (started == 0) worker(&job);
+    for (int t = 0; t < started; t++) pthread_join(tids[t], NULL);
+
+    pthread_mutex_destroy(&job.out_lock);
+    int status = 0;
+    if (atomic_load(&job.failed)) {
+        int err = async_io_error(io);
+        fprintf(stderr, "%s: section points lost: %s\n", args.out_path,
+                err ? strerror(err) : "no output buffer");
+        status = 1;
+    }
+    if (!async_io_flush(io)) {
+        fprintf(stderr, "%s: %s\n", args.out_path, strerror(async_io_error(io)));
+        status = 1;
+    }
+    const char *backend = async_io_backend(io);
+    async_io_destroy(io);
+    if (close(fd) != 0) status = 1;
+    printf("%lu section points for %d energies x %d orbits written to %s (%s)\n",
+           (unsigned long)atomic_load(&job.points), args.energies, args.orbits, args.out_path,
+           backend);
+    free(energy);
+    return status;
+}